@@ -0,0 +1,92 @@
+/*
+ * hdrhist.h
+ * Author: aqrabwi, 13/02/2025 (modified)
+ * Description: Small fixed-size latency histogram in the style of HdrHistogram.
+ *              Values (nanoseconds) are grouped into buckets that keep 7 significant bits,
+ *              so any recorded value is reported within 1/64 (about 1.6%) whatever its
+ *              magnitude, and recording is a couple of shifts and one increment (no
+ *              allocation, no search).
+ *
+ * Bucket layout: values below 128 get a bucket each; above that, every power of two is
+ * split into 64 equal sub-buckets.
+ */
+
+ #ifndef HDRHIST_H
+ #define HDRHIST_H
+
+ #include <string.h>
+
+ // Number of sub-bucket bits kept per value and the resulting bucket count (enough for
+ // any 64-bit value).
+ #define HIST_SUB_BITS 7
+ #define HIST_HALF (1 << (HIST_SUB_BITS - 1))
+ #define HIST_BUCKETS ((64 - HIST_SUB_BITS + 1) * HIST_HALF + HIST_HALF)
+
+ typedef struct {
+     unsigned long long count;   // Values recorded.
+     unsigned long long total;   // Sum of the values.
+     unsigned long long min;
+     unsigned long long max;
+     unsigned long long buckets[HIST_BUCKETS];
+ } Histogram;
+
+ // Reset a histogram to empty.
+ static inline void histReset(Histogram *hist) {
+     memset(hist, 0, sizeof(*hist));
+     hist->min = ~0ULL;
+ }
+
+ // Bucket a value falls into.
+ static inline int histBucket(unsigned long long value) {
+     if (value < 2 * HIST_HALF) {
+         return (int) value;
+     }
+     int shift = 63 - __builtin_clzll(value) - (HIST_SUB_BITS - 1);
+     return shift * HIST_HALF + (int) (value >> shift);
+ }
+
+ // Highest value that falls into the given bucket.
+ static inline unsigned long long histBucketTop(int bucket) {
+     if (bucket < 2 * HIST_HALF) {
+         return bucket;
+     }
+     int shift = bucket / HIST_HALF - 1;
+     unsigned long long sub = bucket - shift * HIST_HALF;
+     return ((sub + 1) << shift) - 1;
+ }
+
+ // Record one value.
+ static inline void histRecord(Histogram *hist, unsigned long long value) {
+     hist->buckets[histBucket(value)]++;
+     hist->count++;
+     hist->total += value;
+     if (value < hist->min) {
+         hist->min = value;
+     }
+     if (value > hist->max) {
+         hist->max = value;
+     }
+ }
+
+ // Value at the given percentile (0-100): the top of the bucket holding that rank,
+ // capped at the largest value recorded.
+ static inline unsigned long long histPercentile(const Histogram *hist, double percentile) {
+     if (hist->count == 0) {
+         return 0;
+     }
+     unsigned long long rank = (unsigned long long) (percentile / 100.0 * hist->count + 0.999999);
+     if (rank < 1) {
+         rank = 1;
+     }
+     unsigned long long seen = 0;
+     for (int i = 0; i < HIST_BUCKETS; i++) {
+         seen += hist->buckets[i];
+         if (seen >= rank) {
+             unsigned long long top = histBucketTop(i);
+             return top < hist->max ? top : hist->max;
+         }
+     }
+     return hist->max;
+ }
+
+ #endif
@@ -0,0 +1,107 @@
+/*
+ * logring.h
+ * Author: aqrabwi, 13/02/2025 (modified)
+ * Description: Shared-memory log ring used by oss and worker for all regular output.
+ *              Any process appends fixed-size text records (multi-producer, lock-free,
+ *              with the queue protocol of seqqueue.h); a single writer thread in oss drains
+ *              them and writes them to stdout in large batches. Producers never make a
+ *              system call unless the writer is asleep and has to be woken.
+ */
+
+ #ifndef LOGRING_H
+ #define LOGRING_H
+
+ #include <stdio.h>
+ #include <stdarg.h>
+ #include <sched.h>
+ #include "simclock.h"
+
+ // Environment variable through which oss passes the log ring's descriptor to workers.
+ #define LOG_FD_ENV "OSS_LOG_FD"
+
+ // Number of records in the ring (a power of two) and the text each can hold.
+ #define LOG_RING_RECORDS 16384
+ #define LOG_TEXT_MAX 246
+
+ // One log record: a complete line of output.
+ typedef struct {
+     unsigned long long seq;     // Sequence number of the record slot (atomic, must come first).
+     unsigned short len;         // Number of bytes used in text.
+     char text[LOG_TEXT_MAX];    // The line, including its newline (not NUL-terminated).
+ } LogRecord;
+
+ // Header of the log ring segment, followed by the records.
+ typedef struct {
+     unsigned long long head __attribute__((aligned(64)));  // Next position producers claim (atomic).
+     unsigned long long tail __attribute__((aligned(64)));  // Next position the writer drains.
+     unsigned int wakeWord;      // Futex word the writer sleeps on (atomic).
+     int writerSleeping;         // Set while the writer sleeps (atomic).
+     LogRecord records[LOG_RING_RECORDS] __attribute__((aligned(64)));
+ } LogRing;
+
+ // Initialize an empty ring (oss, before anything logs).
+ static inline void logRingInit(LogRing *ring) {
+     ring->head = 0;
+     ring->tail = 0;
+     ring->wakeWord = 0;
+     ring->writerSleeping = 0;
+     seqQueueInit(ring->records, sizeof(LogRecord), LOG_RING_RECORDS - 1);
+ }
+
+ // Claim the next free record, waiting for the writer to make room if the ring is full.
+ static inline LogRecord *logRingClaim(LogRing *ring, unsigned long long *pos) {
+     LogRecord *rec;
+     while ((rec = seqQueueClaim(&ring->head, ring->records, sizeof(LogRecord), LOG_RING_RECORDS - 1, pos)) == NULL) {
+         // Full: let the writer run, then look again.
+         sched_yield();
+     }
+     return rec;
+ }
+
+ // Hand a filled record to the writer, waking it if it is asleep.
+ static inline void logRingPublish(LogRing *ring, LogRecord *rec, unsigned long long pos) {
+     seqQueuePublish(rec, pos);
+     // Order the publication before the check (pairs with the writer announcing its sleep).
+     __atomic_thread_fence(__ATOMIC_SEQ_CST);
+     if (__atomic_load_n(&ring->writerSleeping, __ATOMIC_SEQ_CST)) {
+         __atomic_add_fetch(&ring->wakeWord, 1, __ATOMIC_SEQ_CST);
+         futexWake(&ring->wakeWord);
+     }
+ }
+
+ // Append one formatted line to the ring. Lines longer than a record are truncated.
+ static inline void logRingVPrintf(LogRing *ring, const char *format, va_list args) {
+     unsigned long long pos;
+     LogRecord *rec = logRingClaim(ring, &pos);
+     int len = vsnprintf(rec->text, LOG_TEXT_MAX, format, args);
+     if (len < 0) {
+         len = 0;
+     } else if (len >= LOG_TEXT_MAX) {
+         // vsnprintf left room for its NUL; end the truncated line with a newline instead.
+         len = LOG_TEXT_MAX;
+         rec->text[LOG_TEXT_MAX - 1] = '\n';
+     }
+     rec->len = (unsigned short) len;
+     logRingPublish(ring, rec, pos);
+ }
+
+ static inline void logRingPrintf(LogRing *ring, const char *format, ...) __attribute__((format(printf, 2, 3)));
+ static inline void logRingPrintf(LogRing *ring, const char *format, ...) {
+     va_list args;
+     va_start(args, format);
+     logRingVPrintf(ring, format, args);
+     va_end(args);
+ }
+
+ // Take the next published record (writer only). Returns NULL if none is ready yet.
+ static inline LogRecord *logRingPeek(LogRing *ring) {
+     return seqQueuePeek(ring->records, sizeof(LogRecord), LOG_RING_RECORDS - 1, ring->tail);
+ }
+
+ // Give a record returned by logRingPeek back to the producers (writer only).
+ static inline void logRingRelease(LogRing *ring, LogRecord *rec) {
+     seqQueueRelease(rec, ring->tail, LOG_RING_RECORDS - 1);
+     ring->tail++;
+ }
+
+ #endif
@@ -4,18 +4,49 @@
  * Description: Launches worker processes using a simulated system clock in shared memory.
  *              Maintains a process table and launches workers based on command-line parameters.
  *
- * Usage: oss [-h] [-n totalProcs] [-s simulLimit] [-t childTimeLimit] [-i launchIntervalMs]
+ * Usage: oss [-h] [-e] [-b backend] [-v verbosity] [-P] [-R rate] [-T traceFile] [-S seed] [-d distribution] [-a fixed|poisson] [-r replayFile] [-p policy] [-n totalProcs] [-s simulLimit] [-t childTimeLimit] [-i launchIntervalMs]
  *   -n totalProcs        Total number of worker processes to launch (default: 20)
  *   -s simulLimit        Maximum number of workers running concurrently (default: 5)
  *   -t childTimeLimit    Upper bound (in seconds) for a worker's run time (default: 5)
- *   -i launchIntervalMs  Interval (in simulated milliseconds) between launches (default: 100)
+ *   -i launchIntervalMs  Interval (in simulated milliseconds) between job arrivals (default: 100)
+ *                        The process table is sized from simulLimit, so -s has no upper bound.
+ *   -e                   Event-driven mode: jump the clock straight to the next instant where
+ *                        something can happen instead of stepping it 1 ms at a time
+ *   -b backend           How workers are started: fork (fork + execv, default), vfork
+ *                        (vfork + execv), spawn (posix_spawn), pool (pre-started workers
+ *                        that receive each job through a shared-memory mailbox), thread
+ *                        (each worker is a thread inside oss running the same job code) or
+ *                        coro (each worker is a coroutine resumed by oss's own loop)
+ *   -v verbosity         Periodic display: 0 none, 1 one-line summary, 2 full process
+ *                        table (default: 2)
+ *   -R rate              Pace the clock against real time: rate simulated seconds pass per
+ *                        real second (e.g. 1000 = one simulated second per real millisecond);
+ *                        oss sleeps between steps instead of spinning (default: run flat out)
+ *   -P                   Time every phase of the main loop into histograms, printed at exit
+ *                        and whenever oss receives SIGUSR1
+ *   -T traceFile         Also record every launch, worker status line and termination as
+ *                        fixed-width binary records in traceFile (decode with tracedump)
+ *   -S seed              Seed of the worker runtimes; a seed always produces the same
+ *                        runtimes in the same order (default: 1)
+ *   -d distribution      Worker runtimes: uniform (1..childTimeLimit s, default), fixed:S,
+ *                        exp:MEAN, pareto:SHAPE:MIN or bimodal:P:SHORTMEAN:LONGMEAN
+ *                        (all in seconds; see workload.h)
+ *   -a arrivals          fixed (one arrival every launchIntervalMs, default) or poisson
+ *                        (exponential gaps with mean launchIntervalMs)
+ *   -r replayFile        Launch the jobs recorded in replayFile (arrival time and runtime
+ *                        per line, see replay.h) instead of generating them; -n then only
+ *                        limits how many are replayed
+ *   -p policy            Which waiting job is launched when a slot is free: fifo (default),
+ *                        sjf, edf[:FACTOR] or tb:RATE[:BURST] (jobs arrive on schedule,
+ *                        every launchIntervalMs by default, and wait in a queue; see
+ *                        policy.h), or interval (the next job only arrives launchIntervalMs
+ *                        after the previous launch, no backlog)
  */
 
  #include <stdio.h>      
  #include <stdlib.h>     
  #include <unistd.h>     
- #include <sys/shm.h>    
- #include <sys/ipc.h>    
+ #include <sys/mman.h>   
  #include <sys/types.h>  
  #include <sys/wait.h>   
  #include <signal.h>     
@@ -24,21 +55,86 @@
  #include <errno.h>      
  #include <stdbool.h>    
  #include <getopt.h>     
+ #include <sched.h>      
+ #include <spawn.h>      
+ #include <sys/epoll.h>  
+ #include <sys/eventfd.h>
+ #include <sys/syscall.h>
+ #include <sys/resource.h>
+ #include <pthread.h>    
+ #include <stdarg.h>     
+ #include <limits.h>
+ #include "simclock.h"
+ #include "logring.h"
+ #include "trace.h"
+ #include "hdrhist.h"
+ #include "ossstats.h"
+ #include "workerjob.h"
+ #include "workload.h"
+ #include "replay.h"
+ #include "policy.h"
  
- // Defining the key for shared memory segment.
- #define SHMKEY 9876
+ // Size of the buffer the log writer thread fills before each write() to stdout.
+ #define LOG_BATCH_BYTES (1 << 20)
  
- // Maximum number of child processes to track in the process table.
- #define MAX_CHILDREN 20
- 
- // Nanosecond conversion.
- #define ONE_BILLION 1000000000ULL
+ // Alignment of the process table arena (one cache line).
+ #define CACHE_LINE 64
  
  // Default command-line parameters if not provided by the user.
  #define DEFAULT_TOTAL_PROCS 20
  #define DEFAULT_SIMUL_LIMIT 5
  #define DEFAULT_CHILD_TIME_LIMIT 5      // seconds each worker runs, upper bound
  #define DEFAULT_LAUNCH_INTERVAL_MS 100    // simulated milliseconds between launches
+ #define DEFAULT_VERBOSITY 2               // print the full process table every second
+ #define DEFAULT_SEED 1                    // workload seed: runs repeat unless -S changes it
+ 
+ // Simulated time added to the clock by each main loop iteration (1 millisecond).
+ #define TICK_NS 1000000ULL
+ 
+ // Path of the worker executable started by every launch backend.
+ #define WORKER_PATH "./worker"
+ 
+ // Ways of starting a worker process, selected with -b (their names are launchBackendNames
+ // in trace.h, which tracedump also needs).
+ typedef enum {
+     LAUNCH_FORK,     // fork() then execv(): cost grows with oss's address space.
+     LAUNCH_VFORK,    // vfork() then execv(): child borrows oss's memory until exec.
+     LAUNCH_SPAWN,    // posix_spawn(): glibc uses clone(CLONE_VM | CLONE_VFORK) internally.
+     LAUNCH_POOL,     // Pre-started, already attached workers; a launch is a mailbox write.
+     LAUNCH_THREAD,   // A thread inside oss running the worker's job code (workerjob.h).
+     LAUNCH_CORO      // A coroutine resumed by oss's own loop when its deadline is due.
+ } LaunchBackend;
+  
+ // Thread and coroutine workers have no process of their own; they get IDs above any possible PID
+ // (the kernel's PID limit is 2^22) so the log and trace can still tell them apart.
+ #define THREAD_ID_BASE (1 << 22)
+ 
+ // Stack size of a thread worker: a job only needs a few frames and one formatted line.
+ #define THREAD_STACK_BYTES (64 * 1024)
+ 
+ // Phases of the main loop timed with -P.
+ typedef enum {
+     PHASE_WAIT,      // Event mode: waiting for workers to react (includes reaping while blocked).
+     PHASE_PACE,      // -R: sleeping until the next step is due in real time.
+     PHASE_CLOCK,     // Advancing the simulated clock.
+     PHASE_DISPLAY,   // displayTime() (only iterations that display).
+     PHASE_WAKE,      // Draining deadline registrations and waking due workers.
+     PHASE_REAP,      // Collecting terminated children.
+     PHASE_LAUNCH,    // Slot allocation and the launch itself (only iterations that launch).
+     PHASE_LOOP,      // One whole main loop iteration.
+     PHASE_COUNT
+ } LoopPhase;
+ 
+ // Names of the phases in the report, indexed by LoopPhase.
+ const char *phaseNames[] = {"wait", "pace", "clock", "display", "wake", "reap", "launch", "loop"};
+ 
+ // Maximum number of ready events handled per epoll_wait call.
+ #define MAX_EPOLL_EVENTS 64
+ 
+ // epoll user data marking the doorbell eventfd (child entries carry pidfd and PID).
+ #define DOORBELL_EVENT (~0ULL)
+ 
+ extern char **environ;
  
  // Structure representing a Process Control Block (PCB) for each worker.
  typedef struct {
@@ -46,92 +142,1278 @@
      pid_t pid;           // Process ID of the worker process
      int startSeconds;    // Simulated clock seconds at which the worker was launched
      int startNano;       // Simulated clock nanoseconds at which the worker was launched
+     int awake;           // Flag: 1 while the worker runs without a registered deadline
+     int nextFree;        // Next entry on the free-list while this entry is free (-1 ends it)
+     int prevRunning;     // Neighbours on the running list (launch order) while occupied
+     int nextRunning;
+     unsigned long long arrival; // Simulated time the worker's job arrived (ns)
+     int pidfd;           // pidfd watching the worker process's exit (-1 if none)
  } PCB;
  
- PCB processTable[MAX_CHILDREN];
+ // The process table holds simulLimit entries (at most that many workers run at once).
+ // It lives with the PID index in one cache-line-aligned arena allocated at startup.
+ PCB *processTable = NULL;
+ int tableCapacity = 0;
+ 
+ // Head of the free-list of unoccupied process table entries, so a launch finds a slot
+ // in constant time instead of scanning the table (-1 when the table is full).
+ int freeHead = -1;
+ 
+ // Occupied entries are also linked in launch order. Launch times never decrease, so the
+ // head is the oldest running worker and the tail the youngest, which lets the summary
+ // display report ages without scanning the table.
+ int runningHead = -1;
+ int runningTail = -1;
+ unsigned long long runningStartSum = 0;  // Sum of the running workers' launch times (ns).
+ 
+ // Entry of the open-addressing index from worker PID to process table slot, so a reap
+ // finds its entry in constant time. A PID of 0 marks an empty entry.
+ typedef struct {
+     pid_t pid;
+     int slot;
+ } PidIndexEntry;
+ 
+ // The PID index has a power-of-two size at least twice the table, which keeps the
+ // linear probe sequences short; pidIndexMask is that size minus one.
+ PidIndexEntry *pidIndex = NULL;
+ unsigned int pidIndexMask = 0;
  
  // Global variables for shared memory management.
- int shmid;       // Shared memory identifier.
- int *shmClock;   // Pointer to the shared memory segment storing the simulated clock:
- // shmClock[0] holds seconds, shmClock[1] holds nanoseconds.
+ int clockFd = -1;          // memfd holding the clock segment (inherited by workers).
+ size_t clockBytes = 0;     // Size of the clock segment.
+ SimClock *shmClock;        // Pointer to the shared memory segment storing the simulated clock.
+ 
+ // Output: every regular line goes through the shared log ring, drained by one thread.
+ int logFd = -1;                 // memfd holding the log ring (inherited by workers).
+ LogRing *logRing = NULL;        // Attached log ring (NULL until created).
+ pthread_t logThread;            // Thread writing the ring to stdout.
+ volatile int logStop = 0;       // Set to make the writer drain the ring and exit.
+ 
+ // Binary event trace (-T): mapped by oss and every worker.
+ const char *tracePath = NULL;   // NULL when tracing is off.
+ TraceFile trace;
  
  // Global parameters, which may be overridden by command-line options.
  int totalProcs = DEFAULT_TOTAL_PROCS;        // Total number of workers to launch.
  int simulLimit = DEFAULT_SIMUL_LIMIT;          // Maximum workers running concurrently.
  int childTimeLimit = DEFAULT_CHILD_TIME_LIMIT; // Upper bound for worker run time (in seconds).
- int launchIntervalMs = DEFAULT_LAUNCH_INTERVAL_MS; // Interval (in simulated ms) between launching workers.
+ int launchIntervalMs = DEFAULT_LAUNCH_INTERVAL_MS; // Interval (in simulated ms) between job arrivals.
+ bool eventMode = false;                        // Skip the clock to the next event instead of ticking.
+ int verbosity = DEFAULT_VERBOSITY;             // What displayTime() prints.
+ bool phaseTiming = false;                      // Time the main loop phases (-P).
+ unsigned long long workloadSeed = DEFAULT_SEED; // Seed of the worker runtimes and arrivals (-S).
+ DurationGen durations;                         // Runtime distribution (-d) and its current batch.
+ ArrivalProcess arrivalProcess = ARRIVAL_FIXED; // How launches are spaced (-a).
+ ArrivalGen arrivals;                           // Arrival gaps (-a poisson).
+ unsigned long long nextArrivalTime = 0;        // Simulated time of the next arrival (-a poisson).
+ const char *replayPath = NULL;                 // Job replay file (-r), NULL for generated jobs.
+ ReplayFile replay;
+ ReplayJob replayJob;                           // Next job of the replay, not arrived yet.
+ SchedPolicy schedPolicy = POLICY_FIFO;         // How the next job to launch is chosen (-p).
+ double policyParams[2];                        // Its parameters (edf factor, tb rate and burst).
+ PendingQueue pendingJobs;                      // Waiting jobs (sjf, edf) or a job put back (policy.h).
+ TokenBucket launchTokens;                      // Launch rate limit (-p tb).
+ int arrivedCount = 0;                          // Jobs taken from the replay or generators so far.
+ double clockRate = 0.0;                        // Simulated seconds per real second (-R), 0 = unpaced.
+ unsigned long long pacingStartNs = 0;          // CLOCK_MONOTONIC time of simulated time 0 (-R).
+ LaunchBackend launchBackend = LAUNCH_FORK;     // How worker processes are started.
+ 
+ // Pre-started worker pool (pool backend only): pool member i owns process table slot i.
+ pid_t *poolPids = NULL;
+ int poolSize = 0;
+ 
+ // In-process workers (thread and coro backends): the job running in each process table slot.
+ typedef struct {
+     WorkerContext ctx;   // Where the job runs and reports.
+     int sec;             // Run time of the job (thread backend).
+     int nano;
+     WorkerCoroutine co;  // The job's state between resumes (coro backend).
+ } ThreadJob;
+ ThreadJob *threadJobs = NULL;
+ pthread_attr_t threadAttr;
+ int threadLaunches = 0;  // In-process workers started so far (for their IDs).
+ 
+ // Real-time cost of starting workers, for comparing launch backends.
+ unsigned long long launchLatencyTotalNs = 0;   // Sum over all launches.
+ unsigned long long launchLatencyMaxNs = 0;     // Slowest single launch.
  
- // Volatile flag for safe termination in signal handlers.
+ // Live statistics page read by ossstat.
+ int statsFd = -1;                            // memfd holding the page (kept from workers).
+ OssStats *stats = NULL;
+ unsigned long long reapedCount = 0;          // Workers reaped so far.
+ unsigned long long launchFailureCount = 0;   // Launch attempts that failed.
+ unsigned long long loopIterations = 0;       // Main loop iterations so far.
+ 
+ // Main loop phase histograms (-P) and the SIGUSR1 request to print them.
+ Histogram phaseHist[PHASE_COUNT];
+ volatile sig_atomic_t phaseReportRequested = 0;
+ 
+ // Simulation progress shared by the main loop and its helper functions.
+ int launchedCount = 0; // Number of worker processes launched so far.
+ int runningCount = 0;  // Number of worker processes currently running.
+ int awakeCount = 0;    // Number of running workers that have not yet armed a deadline.
+ // Simulated time (ns) of the last launch; the interval policy counts arrivals from it.
+ unsigned long long lastLaunchTime = 0;
+ // Launches and terminations since the last display (for the summary display).
+ int launchesSinceDisplay = 0;
+ int reapsSinceDisplay = 0;
+ // Figures for the run summary printed at exit.
+ int maxRunning = 0;                          // Most workers running at once.
+ unsigned long long lifetimeTotalNs = 0;      // Sum of finished workers' simulated lifetimes.
+ unsigned long long waitTotalNs = 0;          // Sum of launched jobs' waits (arrival to launch).
+ unsigned long long turnaroundTotalNs = 0;    // Sum of finished jobs' turnarounds (arrival to reap).
+ unsigned long long runStartNs = 0;           // CLOCK_MONOTONIC time the main loop started.
+ 
+ // Child reaping: every worker process gets a pidfd in one epoll set, so all exited
+ // children are found with a single epoll_wait. The doorbell eventfd in the same set lets
+ // workers wake oss when it blocks waiting for them.
+ int epollFd = -1;
+ int doorbellFd = -1;
+ bool pidfdSupported = true;   // Cleared if the kernel has no pidfd_open (ENOSYS, pre-5.3).
+ int unwatchedChildren = 0;    // Running children pidfd_open failed for (e.g. EMFILE).
+ 
+ // Set by the SIGINT and SIGALRM handlers to the signal received; the main loop then shuts
+ // oss down, since flushing the log and unmapping segments is not async-signal-safe.
  volatile sig_atomic_t terminateFlag = 0;
  
+ // Function to append one line of output to the log ring (printf-style).
+ void ossLog(const char *format, ...) __attribute__((format(printf, 1, 2)));
+ void ossLog(const char *format, ...) {
+     va_list args;
+     va_start(args, format);
+     logRingVPrintf(logRing, format, args);
+     va_end(args);
+ }
+ 
+ // Function to write a whole buffer to stdout, retrying short writes.
+ void writeAll(const char *buf, size_t len) {
+     while (len > 0) {
+         ssize_t n = write(STDOUT_FILENO, buf, len);
+         if (n < 0) {
+             if (errno == EINTR) {
+                 continue;
+             }
+             return;
+         }
+         buf += n;
+         len -= n;
+     }
+ }
+ 
+ // Log writer thread: copies published records into a large buffer and writes it out
+ // whenever the buffer fills or the ring runs dry, then sleeps until a producer wakes it.
+ // It exits once logStop is set and everything published has been written.
+ void *logWriterThread(void *arg) {
+     static char batch[LOG_BATCH_BYTES];
+     size_t used = 0;
+     while (true) {
+         LogRecord *rec = logRingPeek(logRing);
+         if (rec != NULL) {
+             if (used + rec->len > LOG_BATCH_BYTES) {
+                 writeAll(batch, used);
+                 used = 0;
+             }
+             memcpy(batch + used, rec->text, rec->len);
+             used += rec->len;
+             logRingRelease(logRing, rec);
+             continue;
+         }
+         // Nothing more is ready: write out what we have before sleeping.
+         if (used > 0) {
+             writeAll(batch, used);
+             used = 0;
+             continue;
+         }
+         if (logStop) {
+             break;
+         }
+         // Announce that we sleep, then look once more so a record published before
+         // the announcement became visible is not slept through.
+         unsigned int seen = __atomic_load_n(&logRing->wakeWord, __ATOMIC_SEQ_CST);
+         __atomic_store_n(&logRing->writerSleeping, 1, __ATOMIC_SEQ_CST);
+         if (logRingPeek(logRing) == NULL && !logStop) {
+             struct timespec timeout = {0, 100000000};
+             futexWait(&logRing->wakeWord, seen, &timeout);
+         }
+         __atomic_store_n(&logRing->writerSleeping, 0, __ATOMIC_SEQ_CST);
+     }
+     return NULL;
+ }
+ 
+ // Function to block the signals oss handles in the calling thread, saving the previous
+ // mask. Threads created meanwhile inherit the blocked set, so the handlers only ever run
+ // on the main thread (never, say, on the log writer, which stopLogWriter joins).
+ void blockHandledSignals(sigset_t *saved) {
+     sigset_t handled;
+     sigemptyset(&handled);
+     sigaddset(&handled, SIGINT);
+     sigaddset(&handled, SIGALRM);
+     sigaddset(&handled, SIGUSR1);
+     pthread_sigmask(SIG_BLOCK, &handled, saved);
+ }
+
+ // Function to create the log ring segment and start the writer thread.
+ void startLogWriter() {
+     logRing = (LogRing *) sharedCreate("oss-log", sizeof(LogRing), 1, &logFd);
+     if (logRing == NULL) {
+         perror("oss: log ring");
+         exit(1);
+     }
+     logRingInit(logRing);
+     sharedFdToEnv(LOG_FD_ENV, logFd);
+     sigset_t saved;
+     blockHandledSignals(&saved);
+     int err = pthread_create(&logThread, NULL, logWriterThread, NULL);
+     pthread_sigmask(SIG_SETMASK, &saved, NULL);
+     if (err != 0) {
+         fprintf(stderr, "oss: cannot start log writer thread\n");
+         munmap(logRing, sizeof(LogRing));
+         logRing = NULL;
+         exit(1);
+     }
+ }
+ 
+ // Function to flush every published line, stop the writer and remove the log ring.
+ void stopLogWriter() {
+     if (logRing == NULL) {
+         return;
+     }
+     logStop = 1;
+     __atomic_add_fetch(&logRing->wakeWord, 1, __ATOMIC_SEQ_CST);
+     futexWake(&logRing->wakeWord);
+     pthread_join(logThread, NULL);
+     munmap(logRing, sizeof(LogRing));
+     close(logFd);
+     logRing = NULL;
+ }
+ 
+ // Function to create the statistics page ossstat reads. Like the log ring it is its own
+ // memfd, so a monitor never touches the clock segment the workers use; workers do not
+ // inherit it.
+ void openStats() {
+     stats = (OssStats *) sharedCreate(STATS_NAME, sizeof(OssStats), 0, &statsFd);
+     if (stats == NULL) {
+         perror("oss: stats page");
+         exit(1);
+     }
+     memset(stats, 0, sizeof(*stats));
+     stats->ossPid = getpid();
+     stats->totalProcs = totalProcs;
+     stats->simulLimit = simulLimit;
+     __atomic_store_n(&stats->magic, STATS_MAGIC, __ATOMIC_RELEASE);
+ }
+ 
+ // Function to mark the statistics final and release the page (an attached ossstat keeps
+ // its mapping until it sees the finished flag).
+ void closeStats() {
+     if (stats == NULL) {
+         return;
+     }
+     if (shmClock != NULL) {
+         statsSet(&stats->clockNano, clockNow(shmClock));
+     }
+     statsSet(&stats->loopIterations, loopIterations);
+     __atomic_store_n(&stats->finished, 1, __ATOMIC_RELEASE);
+     munmap(stats, sizeof(OssStats));
+     close(statsFd);
+     stats = NULL;
+ }
+ 
+ // Function returning how many records the trace needs. Each worker writes a start, a
+ // termination and one status event per simulated second, and oss a launch, a reap and
+ // one wake per status or termination, so the size follows the runtimes. They are
+ // counted up front from a copy of the runtime generator (same seed, so the same draws
+ // as the run) or from a pass over the replay file.
+ unsigned long long traceCapacity() {
+     unsigned long long seconds = 0;    // Sum of the runtimes, each rounded up to whole seconds.
+     if (replayPath != NULL) {
+         ReplayFile rf;
+         ReplayJob job;
+         unsigned long long jobs;
+         if (replayOpen(&rf, replayPath, &jobs) == -1) {
+             perror("oss: replay file");
+             exit(1);
+         }
+         // A malformed line ends the count here, and the run once it gets there.
+         for (int i = 0; i < totalProcs && replayNext(&rf, &job) == 1; i++) {
+             seconds += job.sec + (job.nano > 0);
+         }
+         replayClose(&rf);
+     } else {
+         DurationGen gen = durations;
+         durationInit(&gen, workloadSeed, childTimeLimit);
+         for (int i = 0; i < totalProcs; i++) {
+             int sec, nano;
+             durationNext(&gen, &sec, &nano);
+             seconds += sec + (nano > 0);
+         }
+     }
+     return 2 * seconds + 10 * (unsigned long long) totalProcs + 1024;
+ }
+
+ // Function to create the trace file, sized by traceCapacity, and tell workers (through
+ // the environment they inherit) where it is.
+ void openTrace() {
+     if (traceOpen(&trace, tracePath, TRACE_CREATE, traceCapacity()) == -1) {
+         perror("oss: trace file");
+         exit(1);
+     }
+     setenv(TRACE_ENV, tracePath, 1);
+ }
+ 
+ // Function to finish the trace: report dropped events and shrink the file to the
+ // records actually written.
+ void closeTrace() {
+     if (tracePath == NULL || trace.header == NULL) {
+         return;
+     }
+     unsigned long long claimed = trace.header->claimed;
+     unsigned long long count = traceCount(&trace);
+     if (claimed > count) {
+         fprintf(stderr, "oss: trace file full, %llu events dropped\n", claimed - count);
+     }
+     trace.header->capacity = count;
+     trace.header->claimed = count;
+     traceClose(&trace);
+     if (truncate(tracePath, traceFileSize(count)) == -1) {
+         perror("oss: truncate trace file");
+     }
+ }
+ 
  // Cleanup function to detach and remove shared memory and terminate child processes.
- // This function is called when SIGINT (Ctrl-C) or SIGALRM (timeout) is received.
+ // This function is called on fatal errors, and from the main loop once SIGINT (Ctrl-C)
+ // or SIGALRM (timeout) has been received.
  void cleanup(int signum) {
-     // If the shared memory is attached, detach it.
-     if (shmClock != (void *) -1) {
-         shmdt(shmClock);
+     // Write out whatever has been logged so far and remove the log ring.
+     stopLogWriter();
+     closeTrace();
+     closeStats();
+     replayClose(&replay);
+     // If the shared memory is mapped, unmap it. The memfd disappears with the last
+     // process that has it open, so there is nothing to remove. Thread workers may still
+     // be using it; process exit unmaps it for them.
+     if (shmClock != NULL && launchBackend != LAUNCH_THREAD) {
+         munmap(shmClock, clockBytes);
      }
-     // Remove the shared memory segment from the system.
-     shmctl(shmid, IPC_RMID, NULL);
      // Send SIGTERM to all processes in the current process group (to kill all children).
      kill(0, SIGTERM);
      exit(1);
  }
  
- // Alarm handler for timeout after 60 real-life seconds.
- // When the alarm triggers, notify and perform cleanup.
- void alarmHandler(int signum) {
-     printf("Real time limit reached. Terminating oss and all children.\n");
-     cleanup(signum);
+ // Handler for SIGINT (Ctrl-C) and SIGALRM (timeout after 60 real-life seconds): only
+ // record the signal. The main loop notices it, reports it and calls cleanup().
+ void terminateHandler(int signum) {
+     terminateFlag = signum;
+ }
+ 
+ // SIGUSR1 handler: ask the main loop to print the phase histograms.
+ void phaseReportHandler(int signum) {
+     phaseReportRequested = 1;
+ }
+ 
+ // Function to print one line per main loop phase: how often it ran, the total time spent
+ // in it and its latency distribution (microseconds).
+ void reportPhases() {
+     ossLog("Phase     Count      Total ms   Mean us    p50 us     p90 us     p99 us     p99.9 us   Max us\n");
+     for (int i = 0; i < PHASE_COUNT; i++) {
+         Histogram *hist = &phaseHist[i];
+         if (hist->count == 0) {
+             continue;
+         }
+         ossLog("%-9s %-10llu %-10.3f %-10.3f %-10.3f %-10.3f %-10.3f %-10.3f %.3f\n",
+                phaseNames[i], hist->count, hist->total / 1e6, hist->total / 1e3 / hist->count,
+                histPercentile(hist, 50) / 1e3, histPercentile(hist, 90) / 1e3,
+                histPercentile(hist, 99) / 1e3, histPercentile(hist, 99.9) / 1e3, hist->max / 1e3);
+     }
  }
  
  // Function to increment the simulated system clock.
  // It adds the given seconds and nanoseconds to the current clock stored in shared memory.
+ // The clock is one 64-bit nanosecond counter published with a single atomic store,
+ // so workers never observe a half-updated seconds/nanoseconds pair.
  void incrementClock(int secIncrement, int nanoIncrement) {
-     // Add nanosecond increment.
-     shmClock[1] += nanoIncrement;
-     // Add second increment.
-     shmClock[0] += secIncrement;
-     // Normalize the clock: if nanoseconds exceed one billion, convert them to seconds.
-     if (shmClock[1] >= ONE_BILLION) {
-         shmClock[0] += shmClock[1] / ONE_BILLION;
-         shmClock[1] %= ONE_BILLION;
+     unsigned long long now = shmClock->nano;  // oss is the only writer, no atomic load needed.
+     now += (unsigned long long) secIncrement * ONE_BILLION + nanoIncrement;
+     clockSet(shmClock, now);
+ }
+ 
+ // Entry of the deadline min-heap: the simulated time a worker wants to be woken at
+ // and the wait slot it sleeps on.
+ typedef struct {
+     unsigned long long deadline;
+     int slot;
+ } DeadlineEntry;
+ 
+ // Min-heap of registered worker deadlines, ordered by deadline (grown on demand).
+ DeadlineEntry *deadlineHeap = NULL;
+ int heapSize = 0;
+ int heapCapacity = 0;
+ 
+ // Insert a deadline into the heap, sifting it up to its place.
+ void heapPush(unsigned long long deadline, int slot) {
+     if (heapSize == heapCapacity) {
+         heapCapacity = heapCapacity ? heapCapacity * 2 : 64;
+         deadlineHeap = realloc(deadlineHeap, heapCapacity * sizeof(DeadlineEntry));
+         if (deadlineHeap == NULL) {
+             perror("oss: realloc");
+             cleanup(0);
+         }
+     }
+     int i = heapSize++;
+     while (i > 0 && deadlineHeap[(i - 1) / 2].deadline > deadline) {
+         deadlineHeap[i] = deadlineHeap[(i - 1) / 2];
+         i = (i - 1) / 2;
+     }
+     deadlineHeap[i].deadline = deadline;
+     deadlineHeap[i].slot = slot;
+ }
+ 
+ // Remove the earliest deadline from the heap, sifting the last entry down.
+ void heapPop() {
+     DeadlineEntry last = deadlineHeap[--heapSize];
+     int i = 0;
+     while (2 * i + 1 < heapSize) {
+         int child = 2 * i + 1;
+         if (child + 1 < heapSize && deadlineHeap[child + 1].deadline < deadlineHeap[child].deadline) {
+             child++;
+         }
+         if (deadlineHeap[child].deadline >= last.deadline) {
+             break;
+         }
+         deadlineHeap[i] = deadlineHeap[child];
+         i = child;
+     }
+     deadlineHeap[i] = last;
+ }
+ 
+ // Round a size up to a whole number of cache lines.
+ size_t cacheAlign(size_t size) {
+     return (size + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+ }
+ 
+ // Function to allocate the process table and PID index for `capacity` entries in one
+ // zeroed, cache-line-aligned arena, and put every entry on the free-list.
+ // Entries are linked in index order so the lowest slots are handed out first.
+ void initProcessTable(int capacity) {
+     unsigned int indexSize = 16;
+     while (indexSize < 2U * (unsigned int) capacity) {
+         indexSize <<= 1;
+     }
+     size_t tableBytes = cacheAlign((size_t) capacity * sizeof(PCB));
+     size_t indexBytes = cacheAlign((size_t) indexSize * sizeof(PidIndexEntry));
+     char *arena = aligned_alloc(CACHE_LINE, tableBytes + indexBytes);
+     if (arena == NULL) {
+         perror("oss: aligned_alloc");
+         cleanup(0);
+     }
+     memset(arena, 0, tableBytes + indexBytes);
+     processTable = (PCB *) arena;
+     pidIndex = (PidIndexEntry *) (arena + tableBytes);
+     pidIndexMask = indexSize - 1;
+     tableCapacity = capacity;
+ 
+     freeHead = -1;
+     for (int i = capacity - 1; i >= 0; i--) {
+         processTable[i].nextFree = freeHead;
+         freeHead = i;
+     }
+ }
+ 
+ // Function to take a free process table entry off the free-list. Returns -1 if none.
+ int allocSlot() {
+     int slot = freeHead;
+     if (slot != -1) {
+         freeHead = processTable[slot].nextFree;
+     }
+     return slot;
+ }
+ 
+ // Function to put a process table entry back on the free-list.
+ void freeSlot(int slot) {
+     processTable[slot].nextFree = freeHead;
+     freeHead = slot;
+ }
+ 
+ // Function to append a newly launched worker's entry to the running list.
+ void runningAppend(int slot) {
+     PCB *entry = &processTable[slot];
+     entry->prevRunning = runningTail;
+     entry->nextRunning = -1;
+     if (runningTail != -1) {
+         processTable[runningTail].nextRunning = slot;
+     } else {
+         runningHead = slot;
+     }
+     runningTail = slot;
+     runningStartSum += (unsigned long long) entry->startSeconds * ONE_BILLION + entry->startNano;
+     launchesSinceDisplay++;
+ }
+ 
+ // Function to unlink a finished worker's entry from the running list.
+ void runningRemove(int slot) {
+     PCB *entry = &processTable[slot];
+     if (entry->prevRunning != -1) {
+         processTable[entry->prevRunning].nextRunning = entry->nextRunning;
+     } else {
+         runningHead = entry->nextRunning;
+     }
+     if (entry->nextRunning != -1) {
+         processTable[entry->nextRunning].prevRunning = entry->prevRunning;
+     } else {
+         runningTail = entry->prevRunning;
+     }
+     unsigned long long start = (unsigned long long) entry->startSeconds * ONE_BILLION + entry->startNano;
+     runningStartSum -= start;
+     lifetimeTotalNs += clockNow(shmClock) - start;
+     reapsSinceDisplay++;
+ }
+ 
+ // Home position of a PID in the index (multiplicative hashing).
+ unsigned int pidHash(pid_t pid) {
+     return ((unsigned int) pid * 2654435761U) & pidIndexMask;
+ }
+ 
+ // Function to record that a PID now occupies the given slot.
+ void pidIndexInsert(pid_t pid, int slot) {
+     unsigned int i = pidHash(pid);
+     while (pidIndex[i].pid != 0 && pidIndex[i].pid != pid) {
+         i = (i + 1) & pidIndexMask;
+     }
+     pidIndex[i].pid = pid;
+     pidIndex[i].slot = slot;
+ }
+ 
+ // Function to look up the slot of a PID. Returns -1 if the PID is not in the table.
+ int pidIndexFind(pid_t pid) {
+     for (unsigned int i = pidHash(pid); pidIndex[i].pid != 0; i = (i + 1) & pidIndexMask) {
+         if (pidIndex[i].pid == pid) {
+             return pidIndex[i].slot;
+         }
+     }
+     return -1;
+ }
+ 
+ // Function to remove a PID from the index. Later entries of the same probe run are
+ // shifted back into the hole so lookups never need tombstones.
+ void pidIndexRemove(pid_t pid) {
+     unsigned int hole = pidHash(pid);
+     while (pidIndex[hole].pid != pid) {
+         if (pidIndex[hole].pid == 0) {
+             return;
+         }
+         hole = (hole + 1) & pidIndexMask;
+     }
+     unsigned int next = hole;
+     while (true) {
+         next = (next + 1) & pidIndexMask;
+         if (pidIndex[next].pid == 0) {
+             break;
+         }
+         // An entry may move into the hole only if its home position is not in the
+         // cyclic range (hole, next]; otherwise moving it would break its probe run.
+         unsigned int home = pidHash(pidIndex[next].pid);
+         bool stays = (hole <= next) ? (hole < home && home <= next) : (hole < home || home <= next);
+         if (!stays) {
+             pidIndex[hole] = pidIndex[next];
+             hole = next;
+         }
+     }
+     pidIndex[hole].pid = 0;
+ }
+ 
+ // Function to record that the worker in a slot finished: free its process table entry.
+ void jobFinished(int slot) {
+     // Mark the entry as free and decrease the count of running workers.
+     processTable[slot].occupied = 0;
+     runningRemove(slot);
+     pidIndexRemove(processTable[slot].pid);
+     freeSlot(slot);
+     if (processTable[slot].awake) {
+         processTable[slot].awake = 0;
+         awakeCount--;
+     }
+     turnaroundTotalNs += clockNow(shmClock) - processTable[slot].arrival;
+     runningCount--;
+     reapedCount++;
+     statsSet(&stats->running, runningCount);
+     statsSet(&stats->reaped, reapedCount);
+     ossLog("Child PID %d terminated.\n", processTable[slot].pid);
+     if (tracePath != NULL) {
+         traceEmit(&trace, EV_REAP, processTable[slot].pid, slot, clockNow(shmClock), 0, 0, 0, 0);
+     }
+ }
+ 
+ // Function to record that a child process terminated (as reported by waitpid).
+ void childTerminated(pid_t pidTerm) {
+     // Pool members only exit when oss shuts the pool down; losing one mid-run would
+     // leave its slot unable to run jobs, so give up. (Thread workers are never reaped.)
+     if (launchBackend == LAUNCH_POOL) {
+         fprintf(stderr, "oss: pool worker PID %d exited unexpectedly\n", pidTerm);
+         cleanup(0);
+     }
+     // Find the terminated child's entry through the PID index.
+     int slot = pidIndexFind(pidTerm);
+     if (slot != -1 && processTable[slot].occupied) {
+         // Release the child's pidfd; closing it also removes it from the epoll set.
+         if (processTable[slot].pidfd != -1) {
+             close(processTable[slot].pidfd);
+             processTable[slot].pidfd = -1;
+         } else if (pidfdSupported) {
+             unwatchedChildren--;
+         }
+         jobFinished(slot);
+     }
+ }
+ 
+ // Function to run the coroutine worker in a slot until it suspends (coro backend). A
+ // suspended job goes back into the deadline heap; a finished one leaves the table.
+ void coroResume(int slot) {
+     ThreadJob *job = &threadJobs[slot];
+     unsigned long long deadline = workerCoroutineResume(&job->co, &job->ctx);
+     if (deadline == NO_DEADLINE) {
+         jobFinished(slot);
+     } else {
+         heapPush(deadline, slot);
+     }
+ }
+
+ // Function to move newly armed deadlines from the registration queue into the heap.
+ // A registration also means the worker went back to sleep, so it is no longer awake.
+ // Pool workers also report finished jobs through the same queue.
+ void drainRegistrations() {
+     int slot, event;
+     while (clockRegPop(shmClock, &slot, &event)) {
+         if (event == REG_DONE) {
+             if (processTable[slot].occupied) {
+                 jobFinished(slot);
+             }
+             continue;
+         }
+         unsigned long long deadline = __atomic_load_n(&shmClock->waits[slot].deadline, __ATOMIC_ACQUIRE);
+         if (deadline != NO_DEADLINE) {
+             heapPush(deadline, slot);
+         }
+         if (processTable[slot].occupied && processTable[slot].awake) {
+             processTable[slot].awake = 0;
+             awakeCount--;
+         }
+     }
+ }
+ 
+ // Function to wake every worker whose registered deadline has been reached.
+ // Workers sleep on a futex in their wait slot instead of polling the clock and announce
+ // each new deadline through the registration queue; oss moves those into its min-heap
+ // and only touches the workers at the top of the heap, so no table scan is needed.
+ void wakeExpiredWorkers(unsigned long long now) {
+     // Order the clock store before the deadline loads (pairs with waitSlotArm in worker).
+     __atomic_thread_fence(__ATOMIC_SEQ_CST);
+     drainRegistrations();
+     // Wake the workers whose deadlines are due. Entries left over from a slot's previous
+     // owner or from a duplicate registration are harmless: waitSlotExpire rechecks the
+     // deadline actually armed in the slot.
+     while (heapSize > 0 && deadlineHeap[0].deadline <= now) {
+         int due = deadlineHeap[0].slot;
+         unsigned long long deadline = deadlineHeap[0].deadline;
+         heapPop();
+         // Coroutine workers have one heap entry at a time and no wait slot to expire:
+         // resume them right here, which may push their next deadline.
+         if (launchBackend != LAUNCH_CORO && !waitSlotExpire(&shmClock->waits[due], now)) {
+             continue;
+         }
+         if (tracePath != NULL && processTable[due].occupied) {
+             traceEmit(&trace, EV_WAKE, processTable[due].pid, due, now,
+                       deadline / ONE_BILLION, deadline % ONE_BILLION, 0, 0);
+         }
+         if (launchBackend == LAUNCH_CORO) {
+             coroResume(due);
+             continue;
+         }
+         if (!processTable[due].awake) {
+             processTable[due].awake = 1;
+             awakeCount++;
+         }
+     }
+ }
+ 
+ // Function to set up child reaping: the epoll set and the doorbell workers ring.
+ void initReaper() {
+     // Every running worker holds a pidfd, so allow as many descriptors as the hard limit.
+     struct rlimit limit;
+     if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+         limit.rlim_cur = limit.rlim_max;
+         setrlimit(RLIMIT_NOFILE, &limit);
+     }
+     epollFd = epoll_create1(EPOLL_CLOEXEC);
+     if (epollFd == -1) {
+         perror("oss: epoll_create1");
+         cleanup(0);
+     }
+     // The doorbell is deliberately not close-on-exec: workers inherit it.
+     doorbellFd = eventfd(0, EFD_NONBLOCK);
+     if (doorbellFd == -1) {
+         perror("oss: eventfd");
+         cleanup(0);
+     }
+     struct epoll_event ev = {.events = EPOLLIN, .data.u64 = DOORBELL_EVENT};
+     epoll_ctl(epollFd, EPOLL_CTL_ADD, doorbellFd, &ev);
+     shmClock->doorbellFd = doorbellFd;
+     shmClock->ossSleeping = 0;
+ }
+ 
+ // Function to add a newly started child to the epoll set through a pidfd, which becomes
+ // readable when the child exits. Returns the pidfd, or -1 if the child is left to the
+ // waitpid(-1) fallback: for good on a kernel without pidfd_open, otherwise (e.g. out of
+ // descriptors) only for this child.
+ int watchChild(pid_t pid) {
+     if (!pidfdSupported) {
+         return -1;
+     }
+     int fd = (int) syscall(SYS_pidfd_open, pid, 0);
+     if (fd == -1) {
+         if (errno == ENOSYS) {
+             pidfdSupported = false;
+         } else {
+             unwatchedChildren++;
+         }
+         return -1;
+     }
+     struct epoll_event ev = {.events = EPOLLIN, .data.u64 = ((unsigned long long) fd << 32) | (unsigned int) pid};
+     epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+     return fd;
+ }
+ 
+ // Function to reap every child that has exited, in one batch. timeoutMs is passed to
+ // epoll_wait: 0 polls, a positive value blocks until a child exits, the doorbell rings
+ // or the timeout expires.
+ void reapChildren(int timeoutMs) {
+     struct epoll_event events[MAX_EPOLL_EVENTS];
+     int ready;
+     do {
+         ready = epoll_wait(epollFd, events, MAX_EPOLL_EVENTS, timeoutMs);
+         for (int i = 0; i < ready; i++) {
+             if (events[i].data.u64 == DOORBELL_EVENT) {
+                 // Reset the doorbell; the queued registrations are drained by the caller.
+                 unsigned long long count;
+                 if (read(doorbellFd, &count, sizeof(count)) < 0) {
+                     // EAGAIN: already reset.
+                 }
+                 continue;
+             }
+             int fd = (int) (events[i].data.u64 >> 32);
+             pid_t pid = (pid_t) (events[i].data.u64 & 0xffffffffULL);
+             // The pidfd becomes readable just before the child turns into a zombie, so
+             // waitpid can still come back empty; the pidfd then stays in the (level-
+             // triggered) epoll set and is reported again on the next call.
+             pid_t reaped = waitpid(pid, NULL, WNOHANG);
+             if (reaped > 0) {
+                 childTerminated(pid);
+             } else if (reaped == -1 && errno == ECHILD) {
+                 // Someone else already reaped the child: drop the pidfd, or every
+                 // epoll_wait would report it again.
+                 close(fd);
+             }
+         }
+         // A full batch means more children may be ready: keep going without blocking.
+         timeoutMs = 0;
+     } while (ready == MAX_EPOLL_EVENTS);
+     // Children pidfd_open failed for (all of them on kernels without pidfds).
+     if (!pidfdSupported || unwatchedChildren > 0) {
+         pid_t pidTerm;
+         while ((pidTerm = waitpid(-1, NULL, WNOHANG)) > 0) {
+             childTerminated(pidTerm);
+         }
+     }
+ }
+ 
+ // Function used before moving the clock and after waking workers: wait until every
+ // running worker has either armed its next deadline or exited (and been reaped), so
+ // moving the clock cannot skip over anything a worker would have done at the current
+ // instant.
+ // Instead of spinning, oss sleeps in epoll_wait until a child exits or a worker rings
+ // the doorbell after queueing a registration.
+ void waitForQuiescence() {
+     drainRegistrations();
+     reapChildren(0);
+     // A worker that never reacts would keep oss here: give up once oss is to stop.
+     while (awakeCount > 0 && !terminateFlag) {
+         // Announce that we are about to sleep, then look once more so a registration
+         // queued before the announcement became visible is not slept through.
+         __atomic_store_n(&shmClock->ossSleeping, 1, __ATOMIC_SEQ_CST);
+         drainRegistrations();
+         if (awakeCount > 0) {
+             // The timeout is only a safety net (children without a pidfd are only found by polling).
+             reapChildren((pidfdSupported && unwatchedChildren == 0) ? 100 : 1);
+         }
+         __atomic_store_n(&shmClock->ossSleeping, 0, __ATOMIC_SEQ_CST);
+         drainRegistrations();
+     }
+ }
+ 
+ // Function to read the next job of the replay file into replayJob. replayOpen counted
+ // the job lines, so the file cannot run out early; a malformed line ends the run.
+ void nextReplayJob() {
+     if (replayNext(&replay, &replayJob) != 1) {
+         fprintf(stderr, "oss: %s:%ld: expected \"arrivalSec arrivalNano durationSec durationNano\"\n",
+                 replayPath, replay.line);
+         cleanup(0);
+     }
+ }
+
+ // Function returning the simulated time of the next job arrival: the recorded arrival
+ // with -r, otherwise the next Poisson or fixed-interval arrival. Under the interval
+ // policy, fixed arrivals are counted from the previous launch.
+ unsigned long long nextArrival() {
+     if (replayPath != NULL) {
+         return replayJob.arrival;
+     }
+     if (schedPolicy == POLICY_INTERVAL && arrivalProcess == ARRIVAL_FIXED) {
+         return lastLaunchTime + (unsigned long long) launchIntervalMs * 1000000;
+     }
+     return nextArrivalTime;
+ }
+
+ // Function to let the next job arrive into *job: take its runtime from the replay or the
+ // runtime distribution, set its key for the launch policy and move on to the following
+ // arrival.
+ void jobArrives(PendingJob *job) {
+     job->release = nextArrival();
+     if (replayPath != NULL) {
+         job->sec = replayJob.sec;
+         job->nano = replayJob.nano;
+     } else {
+         durationNext(&durations, &job->sec, &job->nano);
+     }
+     unsigned long long runtime = (unsigned long long) job->sec * ONE_BILLION + job->nano;
+     job->seq = arrivedCount++;
+     job->deadline = job->release + (unsigned long long) (policyParams[0] * runtime);
+     job->key = (schedPolicy == POLICY_SJF) ? runtime : (schedPolicy == POLICY_EDF) ? job->deadline : job->release;
+
+     if (replayPath != NULL) {
+         if (arrivedCount < totalProcs) {
+             nextReplayJob();
+         }
+     } else if (arrivalProcess == ARRIVAL_POISSON) {
+         nextArrivalTime += arrivalNext(&arrivals);
+     } else {
+         nextArrivalTime += (unsigned long long) launchIntervalMs * 1000000;
+     }
+ }
+
+ // Function to move every job whose arrival time has come into the pending queue, for
+ // the policies that choose among the waiting jobs (at most PENDING_LIMIT of them).
+ void admitArrivals(unsigned long long now) {
+     while (arrivedCount < totalProcs && nextArrival() <= now && pendingJobs.size < PENDING_LIMIT) {
+         PendingJob job;
+         jobArrives(&job);
+         if (pendingPush(&pendingJobs, &job) != 0) {
+             perror("oss: pending jobs");
+             cleanup(0);
+         }
+     }
+ }
+
+ // Function to choose the job to launch at simulated time `now` according to the launch
+ // policy (the queue order, and the token bucket with -p tb). Policies that launch in
+ // arrival order take the next arrival straight from the replay or the generators, so a
+ // backlog costs no memory; only a job put back after a failed launch (which arrived
+ // before any job still to come) is taken from the queue first.
+ // Returns 0 if no job may be launched now.
+ int takeNextJob(unsigned long long now, PendingJob *job) {
+     if (policyQueues(schedPolicy)) {
+         admitArrivals(now);
+     }
+     bool arrived = !policyQueues(schedPolicy) && arrivedCount < totalProcs && nextArrival() <= now;
+     if (pendingJobs.size == 0 && !arrived) {
+         return 0;
+     }
+     if (schedPolicy == POLICY_TOKEN) {
+         tokenRefill(&launchTokens, now);
+         if (!tokenTake(&launchTokens)) {
+             return 0;
+         }
+     }
+     if (pendingJobs.size > 0) {
+         pendingPop(&pendingJobs, job);
+     } else {
+         jobArrives(job);
+     }
+     return 1;
+ }
+
+ // Function to put back a job that could not be launched; it keeps its place in the queue.
+ void returnJob(const PendingJob *job) {
+     if (pendingPush(&pendingJobs, job) != 0) {
+         perror("oss: pending jobs");
+         cleanup(0);
+     }
+     if (schedPolicy == POLICY_TOKEN) {
+         tokenReturn(&launchTokens);
+     }
+ }
+
+ // Function returning the simulated time from which the next launch is possible (given a
+ // free slot): now if a job is waiting, otherwise the next arrival, and with -p tb not
+ // before the bucket holds a token again.
+ unsigned long long nextLaunchTime(unsigned long long now) {
+     unsigned long long at = (pendingJobs.size > 0) ? now : nextArrival();
+     if (schedPolicy == POLICY_TOKEN && tokenReadyAt(&launchTokens) > at) {
+         at = tokenReadyAt(&launchTokens);
+     }
+     return at;
+ }
+
+ // Function returning the next simulated instant at which something can happen:
+ // the next display of the process table (each whole second), the next launch (when a
+ // launch is possible) or the earliest worker deadline. Deadlines are rounded up to the
+ // 1 ms tick grid so events fall on exactly the instants the ticking mode would use.
+ unsigned long long nextEventTime(unsigned long long now) {
+     unsigned long long next = (now / ONE_BILLION + 1) * ONE_BILLION;
+     if (launchedCount < totalProcs && runningCount < simulLimit) {
+         // Arrivals can fall between ticks; launches happen on the tick after them.
+         unsigned long long launchAt = (nextLaunchTime(now) + TICK_NS - 1) / TICK_NS * TICK_NS;
+         if (launchAt < next) {
+             next = launchAt;
+         }
+     }
+     if (heapSize > 0) {
+         unsigned long long deadline = (deadlineHeap[0].deadline + TICK_NS - 1) / TICK_NS * TICK_NS;
+         if (deadline < next) {
+             next = deadline;
+         }
+     }
+     // Always move forward by at least one tick.
+     if (next < now + TICK_NS) {
+         next = now + TICK_NS;
      }
+     return next;
+ }
+ 
+ // Function returning CLOCK_MONOTONIC in nanoseconds, used to time launches.
+ unsigned long long monotonicNs() {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (unsigned long long) ts.tv_sec * ONE_BILLION + ts.tv_nsec;
+ }
+ 
+ // Function to close the current main loop phase (-P): record the time since *start
+ // and make now the start of the next phase.
+ void phaseEnd(LoopPhase phase, unsigned long long *start) {
+     unsigned long long now = monotonicNs();
+     histRecord(&phaseHist[phase], now - *start);
+     *start = now;
+ }
+ 
+ // Function used with -R before moving the clock to simTarget: sleep until the real time
+ // at which that simulated time is due. Deadlines are absolute (derived from the start of
+ // the run, not from the previous step), so time spent working or printing never makes the
+ // clock drift; when oss is behind it does not sleep and catches up.
+ void paceClock(unsigned long long simTarget) {
+     unsigned long long due = pacingStartNs + (unsigned long long) (simTarget / clockRate);
+     struct timespec deadline = {(time_t) (due / ONE_BILLION), (long) (due % ONE_BILLION)};
+     while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {
+         // A signal interrupted the sleep: keep waiting unless oss is to stop (SIGUSR1
+         // with -P only asks for a report).
+         if (terminateFlag) {
+             break;
+         }
+     }
+ }
+ 
+ // Body of a thread worker: run the job posted in its slot, then report it done the way a
+ // pool member does. The report is the last use of the slot's record, which oss may reuse
+ // as soon as the report is queued; the thread still reads the clock segment to ring the
+ // doorbell, so oss never unmaps the segment under the thread backend.
+ void *threadWorker(void *arg) {
+     ThreadJob *job = (ThreadJob *) arg;
+     workerRunJob(&job->ctx, job->sec, job->nano);
+     workerJobDone(&job->ctx);
+     return NULL;
+ }
+ 
+ // Function to prepare the thread and coro backends: one job record per slot and (for
+ // threads) small detached threads, so a large table fits in memory.
+ void startThreads() {
+     threadJobs = calloc(tableCapacity, sizeof(ThreadJob));
+     if (threadJobs == NULL) {
+         perror("oss: calloc");
+         cleanup(0);
+     }
+     pthread_attr_init(&threadAttr);
+     pthread_attr_setstacksize(&threadAttr, THREAD_STACK_BYTES);
+     pthread_attr_setdetachstate(&threadAttr, PTHREAD_CREATE_DETACHED);
+ }
+ 
+ // Function to start one worker process with the selected backend.
+ // The worker gets its runtime and the slot number of the wait slot it sleeps on.
+ // Returns the child's PID, or -1 (with errno set) if the worker could not be started.
+ pid_t launchWorker(int slot, int sec, int nano) {
+     // Prepare the arguments up front: after vfork() the child may only call execv/_exit.
+     char secArg[16], nanoArg[16], slotArg[16];
+     sprintf(secArg, "%d", sec);
+     sprintf(nanoArg, "%d", nano);
+     sprintf(slotArg, "%d", slot);
+     char *args[] = {"worker", secArg, nanoArg, slotArg, NULL};
+ 
+     pid_t pid;
+     switch (launchBackend) {
+         case LAUNCH_POOL:
+             // The pool member owning this slot is already running and attached:
+             // launching is just posting the job to its mailbox and waking it.
+             waitSlotPostJob(&shmClock->waits[slot], sec, nano);
+             return poolPids[slot];
+         case LAUNCH_THREAD: {
+             // Start a thread in oss that runs the job against the same clock, wait slot,
+             // log ring and trace a worker process would use.
+             ThreadJob *job = &threadJobs[slot];
+             job->ctx = (WorkerContext) {
+                 .clock = shmClock, .waitSlot = &shmClock->waits[slot], .slot = slot,
+                 .pid = THREAD_ID_BASE + threadLaunches, .ppid = getpid(), .parent = 0,
+                 .logRing = logRing, .trace = (tracePath != NULL) ? &trace : NULL,
+             };
+             job->sec = sec;
+             job->nano = nano;
+             pthread_t thread;
+             sigset_t saved;
+             blockHandledSignals(&saved);
+             int err = pthread_create(&thread, &threadAttr, threadWorker, job);
+             pthread_sigmask(SIG_SETMASK, &saved, NULL);
+             if (err != 0) {
+                 errno = err;
+                 return -1;
+             }
+             return THREAD_ID_BASE + threadLaunches++;
+         }
+         case LAUNCH_CORO: {
+             // Nothing starts running here: the caller resumes the coroutine once the
+             // launch is recorded, and from then on whenever its deadline comes due.
+             ThreadJob *job = &threadJobs[slot];
+             job->ctx = (WorkerContext) {
+                 .clock = shmClock, .waitSlot = NULL, .slot = slot,
+                 .pid = THREAD_ID_BASE + threadLaunches, .ppid = getpid(), .parent = 0,
+                 .logRing = logRing, .trace = (tracePath != NULL) ? &trace : NULL,
+             };
+             job->co = (WorkerCoroutine) {.pc = 0, .secondsToStay = sec, .nanoToStay = nano};
+             return THREAD_ID_BASE + threadLaunches++;
+         }
+         case LAUNCH_VFORK:
+             pid = vfork();
+             if (pid == 0) {
+                 execv(WORKER_PATH, args);
+                 // If execv returns, an error occurred; only _exit is safe here.
+                 _exit(1);
+             }
+             return pid;
+         case LAUNCH_SPAWN: {
+             int err = posix_spawn(&pid, WORKER_PATH, NULL, NULL, args, environ);
+             if (err != 0) {
+                 errno = err;
+                 return -1;
+             }
+             return pid;
+         }
+         case LAUNCH_FORK:
+         default:
+             pid = fork();
+             if (pid == 0) {
+                 // Child process: execute the worker.
+                 execv(WORKER_PATH, args);
+                 // If execv returns, an error occurred.
+                 perror("oss: execv");
+                 exit(1);
+             }
+             return pid;
+     }
+ }
+ 
+ // Function to start the worker pool: one member per slot that can be in use at once.
+ // Members attach to shared memory once and then wait for jobs in their slot's mailbox.
+ void startPool() {
+     poolSize = tableCapacity;
+     poolPids = malloc(poolSize * sizeof(pid_t));
+     if (poolPids == NULL) {
+         perror("oss: malloc");
+         cleanup(0);
+     }
+     for (int i = 0; i < poolSize; i++) {
+         char slotArg[16];
+         sprintf(slotArg, "%d", i);
+         char *args[] = {"worker", "-p", slotArg, NULL};
+         int err = posix_spawn(&poolPids[i], WORKER_PATH, NULL, NULL, args, environ);
+         if (err != 0) {
+             errno = err;
+             perror("oss: posix_spawn pool worker");
+             cleanup(0);
+         }
+         // Watch the member so an unexpected exit is noticed.
+         watchChild(poolPids[i]);
+     }
+ }
+ 
+ // Function to shut the worker pool down: tell every member to exit and wait for it.
+ void stopPool() {
+     for (int i = 0; i < poolSize; i++) {
+         waitSlotPostJob(&shmClock->waits[i], JOB_EXIT, 0);
+     }
+     for (int i = 0; i < poolSize; i++) {
+         waitpid(poolPids[i], NULL, 0);
+     }
+ }
+ 
+ // Function to print a one-line summary of the process table. Everything comes from
+ // counters kept up to date at launch and termination, so the cost does not depend on
+ // the table size.
+ void displaySummary(unsigned long long now) {
+     int sec, nano;
+     clockSplit(now, &sec, &nano);
+     double minAge = 0.0, meanAge = 0.0, maxAge = 0.0;
+     if (runningCount > 0) {
+         PCB *oldest = &processTable[runningHead];
+         PCB *youngest = &processTable[runningTail];
+         maxAge = (now - ((unsigned long long) oldest->startSeconds * ONE_BILLION + oldest->startNano)) / 1e9;
+         minAge = (now - ((unsigned long long) youngest->startSeconds * ONE_BILLION + youngest->startNano)) / 1e9;
+         meanAge = (now - (double) runningStartSum / runningCount) / 1e9;
+     }
+     ossLog("OSS PID: %d | SysClock: %d s, %d ns | Running: %d/%d | Age min/mean/max: %.3f/%.3f/%.3f s | Launched: +%d | Terminated: +%d\n",
+            getpid(), sec, nano, runningCount, tableCapacity, minAge, meanAge, maxAge,
+            launchesSinceDisplay, reapsSinceDisplay);
  }
  
  // Function to display the current simulated clock and the process table.
  // This is useful for debugging and tracking simulation progress.
+ // With -v 1 only a one-line summary is printed, and with -v 0 nothing.
  void displayTime() {
+     unsigned long long now = clockNow(shmClock);
+     if (verbosity == 1) {
+         displaySummary(now);
+     }
+     if (verbosity >= 1) {
+         launchesSinceDisplay = 0;
+         reapsSinceDisplay = 0;
+     }
+     if (verbosity < 2) {
+         return;
+     }
      // Print the OSS process ID and the current simulated clock time.
-     printf("OSS PID: %d | SysClock: %d s, %d ns\n", getpid(), shmClock[0], shmClock[1]);
-     printf("Process Table:\n");
-     printf("Entry  Occupied  PID     StartSec  StartNano\n");
+     int sec, nano;
+     clockSplit(now, &sec, &nano);
+     ossLog("OSS PID: %d | SysClock: %d s, %d ns\n", getpid(), sec, nano);
+     ossLog("Process Table:\n");
+     ossLog("Entry  Occupied  PID     StartSec  StartNano\n");
      // Loop over each entry in the process table and print its status.
-     for (int i = 0; i < MAX_CHILDREN; i++) {
-         printf("%-6d %-9d %-7d %-9d %-9d\n", i, processTable[i].occupied, processTable[i].pid,
+     for (int i = 0; i < tableCapacity; i++) {
+         ossLog("%-6d %-9d %-7d %-9d %-9d\n", i, processTable[i].occupied, processTable[i].pid,
                 processTable[i].startSeconds, processTable[i].startNano);
      }
-     printf("\n");
+     ossLog("\n");
  }
  
  int main(int argc, char *argv[]) {
      int opt;
+     bool totalGiven = false;
      // Parse command-line options using getopt.
      // Options:
      //  -h: help
      //  -n: total number of worker processes to launch
      //  -s: maximum number of simultaneous workers
      //  -t: upper bound for worker run time (in seconds)
-     //  -i: simulated interval (ms) between launching workers
-     while ((opt = getopt(argc, argv, "hn:s:t:i:")) != -1) {
+     //  -i: simulated interval (ms) between job arrivals
+     //  -e: event-driven clock (skip straight to the next interesting instant)
+     //  -b: launch backend (fork, vfork, spawn, pool, thread or coro)
+     //  -v: display verbosity (0, 1 or 2)
+     //  -R: clock rate against real time
+     //  -P: time the main loop phases
+     //  -T: binary trace file
+     //  -S: workload seed
+     //  -d: runtime distribution
+     //  -a: arrival process
+     //  -r: job replay file
+     //  -p: launch policy
+     while ((opt = getopt(argc, argv, "heb:v:R:PT:S:d:a:r:p:n:s:t:i:")) != -1) {
          switch (opt) {
              case 'h':
                  // Display help/usage information.
-                 printf("Usage: %s [-n totalProcs] [-s simulLimit] [-t childTimeLimit] [-i launchIntervalMs]\n", argv[0]);
+                 printf("Usage: %s [-e] [-b fork|vfork|spawn|pool|thread|coro] [-v 0|1|2] [-R rate] [-P] [-T traceFile] [-S seed] [-d distribution] [-a fixed|poisson] [-r replayFile] [-p policy] [-n totalProcs] [-s simulLimit] [-t childTimeLimit] [-i launchIntervalMs]\n", argv[0]);
                  exit(0);
+             case 'e':
+                 // Use the event-driven clock.
+                 eventMode = true;
+                 break;
+             case 'v':
+                 // Set how much the periodic display prints.
+                 verbosity = atoi(optarg);
+                 break;
+             case 'R':
+                 // Pace the clock at this many simulated seconds per real second.
+                 clockRate = atof(optarg);
+                 if (clockRate <= 0) {
+                     fprintf(stderr, "Error: clock rate must be positive.\n");
+                     exit(1);
+                 }
+                 break;
+             case 'P':
+                 // Time the main loop phases.
+                 phaseTiming = true;
+                 break;
+             case 'T':
+                 // Record a binary event trace.
+                 tracePath = optarg;
+                 break;
+             case 'S':
+                 // Seed the worker runtimes.
+                 workloadSeed = strtoull(optarg, NULL, 0);
+                 break;
+             case 'd':
+                 // Select the runtime distribution and its parameters.
+                 if (durationParse(&durations, optarg) != 0) {
+                     fprintf(stderr, "Invalid runtime distribution: %s\n", optarg);
+                     exit(1);
+                 }
+                 break;
+             case 'a': {
+                 // Select the arrival process by name.
+                 int found = 0;
+                 for (int i = 0; i <= ARRIVAL_POISSON; i++) {
+                     if (strcmp(optarg, arrivalNames[i]) == 0) {
+                         arrivalProcess = (ArrivalProcess) i;
+                         found = 1;
+                     }
+                 }
+                 if (!found) {
+                     fprintf(stderr, "Unknown arrival process: %s\n", optarg);
+                     exit(1);
+                 }
+                 break;
+             }
+             case 'p':
+                 // Select the launch policy and its parameters.
+                 if (policyParse(optarg, &schedPolicy, policyParams) != 0) {
+                     fprintf(stderr, "Invalid launch policy: %s\n", optarg);
+                     exit(1);
+                 }
+                 break;
+             case 'r':
+                 // Replay recorded jobs.
+                 replayPath = optarg;
+                 break;
+             case 'b': {
+                 // Select the launch backend by name.
+                 int found = 0;
+                 for (int i = 0; i <= LAUNCH_CORO; i++) {
+                     if (strcmp(optarg, launchBackendNames[i]) == 0) {
+                         launchBackend = (LaunchBackend) i;
+                         found = 1;
+                     }
+                 }
+                 if (!found) {
+                     fprintf(stderr, "Unknown launch backend: %s\n", optarg);
+                     exit(1);
+                 }
+                 break;
+             }
              case 'n':
                  // Set total number of worker processes.
                  totalProcs = atoi(optarg);
+                 totalGiven = true;
                  break;
              case 's':
                  // Set maximum number of simultaneous workers.
@@ -153,122 +1435,325 @@
      }
   
      // Set up signal handlers for SIGINT (e.g., Ctrl-C) and SIGALRM (timeout).
-     signal(SIGINT, cleanup);
-     signal(SIGALRM, alarmHandler);
+     signal(SIGINT, terminateHandler);
+     signal(SIGALRM, terminateHandler);
+     if (phaseTiming) {
+         for (int i = 0; i < PHASE_COUNT; i++) {
+             histReset(&phaseHist[i]);
+         }
+         signal(SIGUSR1, phaseReportHandler);
+     }
      alarm(60);  // Automatically terminate after 60 real-life seconds.
+
+     // A replay launches the jobs in the file (or the first -n of them).
+     if (replayPath != NULL) {
+         unsigned long long jobs;
+         if (replayOpen(&replay, replayPath, &jobs) == -1) {
+             perror("oss: replay file");
+             exit(1);
+         }
+         if (!totalGiven || jobs < (unsigned long long) totalProcs) {
+             totalProcs = jobs > INT_MAX ? INT_MAX : (int) jobs;
+         }
+     }
   
-     // Create a shared memory segment for the simulated clock (2 integers: seconds and nanoseconds).
-     shmid = shmget(SHMKEY, 2 * sizeof(int), IPC_CREAT | 0666);
-     if (shmid == -1) {
-         perror("oss: shmget");
+     // Size the process table from the simultaneous limit.
+     if (simulLimit < 1) {
+         fprintf(stderr, "oss: simulLimit must be at least 1\n");
          exit(1);
      }
-     // Attach the shared memory segment to our address space.
-     shmClock = (int *) shmat(shmid, NULL, 0);
-     if (shmClock == (int *) -1) {
-         perror("oss: shmat");
-         exit(1);
+ 
+     // Create the trace file before any worker starts, so they all inherit its name.
+     if (tracePath != NULL) {
+         openTrace();
+     }
+ 
+     // Route all regular output through the log ring from here on.
+     startLogWriter();
+     openStats();
+     initProcessTable(simulLimit);
+ 
+     // Create a shared memory segment for the simulated clock (one 64-bit nanosecond counter)
+     // followed by one futex wait slot per process table entry.
+     // It is an anonymous memfd private to this oss and its workers, which inherit the
+     // descriptor and find its number in the environment.
+     clockBytes = clockSegmentSize(tableCapacity);
+     shmClock = (SimClock *) sharedCreate("oss-clock", clockBytes, 1, &clockFd);
+     if (shmClock == NULL) {
+         perror("oss: clock segment");
+         cleanup(0);
      }
+     sharedFdToEnv(CLOCK_FD_ENV, clockFd);
      // Initialize the simulated clock to 0 seconds and 0 nanoseconds.
-     shmClock[0] = 0;  // seconds
-     shmClock[1] = 0;  // nanoseconds
-  
-     // Initialize the process table by marking all entries as free.
-     for (int i = 0; i < MAX_CHILDREN; i++) {
-         processTable[i].occupied = 0;
+     clockSet(shmClock, 0);
+     // Initialize the wait slots: nobody is waiting yet.
+     shmClock->capacity = tableCapacity;
+     for (int i = 0; i < tableCapacity; i++) {
+         shmClock->waits[i].deadline = NO_DEADLINE;
+         shmClock->waits[i].wakeWord = 0;
+         shmClock->waits[i].jobWord = 0;
+     }
+     clockRegInit(shmClock);
+ 
+     // Set up child reaping before the first worker starts.
+     initReaper();
+ 
+     // With the pool backend, start every worker process up front.
+     if (launchBackend == LAUNCH_POOL) {
+         startPool();
+     }
+     // With the thread backend, workers run inside oss and report like pool members;
+     // with the coro backend they run on oss's own thread, resumed from the main loop.
+     if (launchBackend == LAUNCH_THREAD || launchBackend == LAUNCH_CORO) {
+         startThreads();
      }
   
-     int launchedCount = 0; // Number of worker processes launched so far.
-     int runningCount = 0;  // Number of worker processes currently running.
-     // Record the last launch time (in simulated nanoseconds) to enforce the launch interval.
-     unsigned long long lastLaunchTime = 0;
-  
+     // Every run with the same seed and workload options draws the same worker runtimes
+     // (and arrival gaps) in the same order, whatever the backend or clock mode.
+     durationInit(&durations, workloadSeed, childTimeLimit);
+     if (arrivalProcess == ARRIVAL_POISSON) {
+         arrivalInit(&arrivals, workloadSeed, (double) launchIntervalMs * 1000000);
+         nextArrivalTime = arrivalNext(&arrivals);
+     } else {
+         nextArrivalTime = (unsigned long long) launchIntervalMs * 1000000;
+     }
+     if (schedPolicy == POLICY_TOKEN) {
+         tokenInit(&launchTokens, policyParams[0], policyParams[1]);
+     }
+     if (replayPath != NULL && totalProcs > 0) {
+         nextReplayJob();
+     }
+
      // Main loop: continue until all workers have been launched and all have terminated.
+     // With -R, simulated time 0 is now. The run summary's wall time starts here too.
+     pacingStartNs = monotonicNs();
+     runStartNs = pacingStartNs;
+ 
+     // With -P each phase is timed from the end of the previous one, so every iteration
+     // costs one clock read per phase.
+     unsigned long long phaseStart = 0, loopStart = 0;
      while (launchedCount < totalProcs || runningCount > 0) {
-         // Increment the simulated clock by 1 millisecond (1,000,000 ns).
-         incrementClock(0, 1000000);
+         if (terminateFlag) {
+             if (terminateFlag == SIGALRM) {
+                 ossLog("Real time limit reached. Terminating oss and all children.\n");
+             }
+             cleanup(terminateFlag);
+         }
+         if (phaseTiming) {
+             if (phaseReportRequested) {
+                 phaseReportRequested = 0;
+                 reportPhases();
+             }
+             loopStart = phaseStart = monotonicNs();
+         }
+ 
+         // First let every worker finish reacting to the current instant (the ones just
+         // launched start and arm their first deadline), so the clock never runs ahead of
+         // a worker that is still on its way to sleep and every worker ends within a tick
+         // of its target, however the host schedules it.
+         waitForQuiescence();
+         // Workers launched at the last instant may have exited already: stop once the
+         // run is complete instead of stepping the clock past the last exit.
+         if (launchedCount >= totalProcs && runningCount == 0) {
+             break;
+         }
+         // Increment the simulated clock by 1 millisecond (1,000,000 ns), or in
+         // event-driven mode jump straight to the next instant where anything can happen.
+         unsigned long long step = TICK_NS;
+         if (eventMode) {
+             unsigned long long now = clockNow(shmClock);
+             step = nextEventTime(now) - now;
+         }
+         if (phaseTiming) {
+             phaseEnd(PHASE_WAIT, &phaseStart);
+         }
+         if (clockRate > 0) {
+             paceClock(clockNow(shmClock) + step);
+             if (phaseTiming) {
+                 phaseEnd(PHASE_PACE, &phaseStart);
+             }
+         }
+         incrementClock(0, step);
+         loopIterations++;
+         statsSet(&stats->loopIterations, loopIterations);
+         if (phaseTiming) {
+             phaseEnd(PHASE_CLOCK, &phaseStart);
+         }
   
+         // Compute the current simulated time in nanoseconds.
+         unsigned long long currentSimTime = clockNow(shmClock);
+         statsSet(&stats->clockNano, currentSimTime);
+         int simSec, simNano;
+         clockSplit(currentSimTime, &simSec, &simNano);
+ 
          // Display the process table periodically when the nanosecond counter resets (roughly every second).
-         if (shmClock[1] < 1000000) {
+         if (simNano < TICK_NS) {
              displayTime();
-         }
-  
-         // Check for any terminated children using a nonblocking wait.
-         int status;
-         pid_t pidTerm = waitpid(-1, &status, WNOHANG);
-         if (pidTerm > 0) {
-             // Search for the terminated child's entry in the process table.
-             for (int i = 0; i < MAX_CHILDREN; i++) {
-                 if (processTable[i].occupied && processTable[i].pid == pidTerm) {
-                     // Mark the entry as free and decrease the count of running workers.
-                     processTable[i].occupied = 0;
-                     runningCount--;
-                     printf("Child PID %d terminated.\n", pidTerm);
-                     break;
-                 }
+             if (phaseTiming) {
+                 phaseEnd(PHASE_DISPLAY, &phaseStart);
              }
          }
+ 
+         // Wake the workers whose deadlines were reached by this clock increment.
+         wakeExpiredWorkers(currentSimTime);
+         if (phaseTiming) {
+             phaseEnd(PHASE_WAKE, &phaseStart);
+         }
+         // Let the woken workers react before reaping and launching, so a worker that
+         // exits at this instant frees its slot at this instant, whatever the host's
+         // scheduling.
+         waitForQuiescence();
+         if (phaseTiming) {
+             phaseEnd(PHASE_WAIT, &phaseStart);
+         }
   
-         // Compute the current simulated time in nanoseconds.
-         unsigned long long currentSimTime = ((unsigned long long) shmClock[0]) * ONE_BILLION + shmClock[1];
+         // Reap every child that terminated since the last tick, without blocking.
+         reapChildren(0);
+         if (phaseTiming) {
+             phaseEnd(PHASE_REAP, &phaseStart);
+         }
   
-         // Conditions to launch a new worker:
+         // Launch workers as long as all three conditions hold, so every free slot can be
+         // filled in the same tick (e.g. after several workers exited at once):
          // 1. Not all required workers have been launched.
          // 2. Running workers are below the simultaneous limit.
-         // 3. Sufficient simulated time has passed since the last launch.
-         if (launchedCount < totalProcs && runningCount < simulLimit &&
-             (currentSimTime - lastLaunchTime) >= ((unsigned long long) launchIntervalMs) * 1000000) {
+         // 3. The launch policy has a job to launch now (one has arrived and, with
+         //    -p tb, a token is available). Jobs arrive when their arrival time has come:
+         //    by default job k arrives k launch intervals into the run.
+         PendingJob job;
+         bool launching = false;
+         while (launchedCount < totalProcs && runningCount < simulLimit &&
+                takeNextJob(currentSimTime, &job)) {
+             launching = true;
   
-             // Find a free slot in the process table.
-             int slot = -1;
-             for (int i = 0; i < MAX_CHILDREN; i++) {
-                 if (!processTable[i].occupied) {
-                     slot = i;
-                     break;
-                 }
+             // Take a free slot off the process table's free-list.
+             int slot = allocSlot();
+             if (slot == -1) {
+                 returnJob(&job);
+                 break;
              }
-             if (slot != -1) {
-                 // Generate a random runtime for the worker:
-                 // Random seconds between 1 and childTimeLimit, and random nanoseconds between 0 and 1e9-1.
-                 int randSec = (rand() % childTimeLimit) + 1;
-                 int randNano = rand() % ONE_BILLION;
+             // The job's runtime was drawn when it arrived: from the replay, or else
+             // from the selected distribution (by default random seconds between 1
+             // and childTimeLimit plus random nanoseconds).
+             int randSec = job.sec;
+             int randNano = job.nano;
+ 
+             // Make sure the slot's new owner starts without a stale deadline.
+             shmClock->waits[slot].deadline = NO_DEADLINE;
   
-                 // Fork a new worker process.
-                 pid_t pid = fork();
-                 if (pid < 0) {
-                     perror("oss: fork");
+             // Start a new worker process and time how long the launch takes.
+             unsigned long long launchStart = monotonicNs();
+             pid_t pid = launchWorker(slot, randSec, randNano);
+             unsigned long long launchNs = monotonicNs() - launchStart;
+             if (pid < 0) {
+                 // Keep the launch error before anything else can overwrite errno.
+                 int err = errno;
+                 freeSlot(slot);
+                 returnJob(&job);
+                 launchFailureCount++;
+                 statsSet(&stats->launchFailures, launchFailureCount);
+                 // Running out of processes is temporary: try again on a later tick.
+                 if (err != EAGAIN) {
+                     fprintf(stderr, "oss: launch: %s\n", strerror(err));
                      cleanup(0);
-                 } else if (pid == 0) {
-                     // Child process: Prepare arguments and execute the worker.
-                     char secArg[16], nanoArg[16];
-                     sprintf(secArg, "%d", randSec);
-                     sprintf(nanoArg, "%d", randNano);
-                     execl("./worker", "worker", secArg, nanoArg, (char *)NULL);
-                     // If execl returns, an error occurred.
-                     perror("oss: execl");
-                     exit(1);
-                 } else {
-                     // Parent process: Record the new worker in the process table.
-                     processTable[slot].occupied = 1;
-                     processTable[slot].pid = pid;
-                     processTable[slot].startSeconds = shmClock[0];
-                     processTable[slot].startNano = shmClock[1];
-                     launchedCount++;   // Increment the count of launched workers.
-                     runningCount++;    // Increment the count of currently running workers.
-                     // Update the last launch time to the current simulated time.
-                     lastLaunchTime = currentSimTime;
-                     printf("Launched worker PID %d at simulated time %d s, %d ns. (Worker will run for %d s and %d ns)\n",
-                            pid, shmClock[0], shmClock[1], randSec, randNano);
                  }
+                 ossLog("oss: launch failed (%s), retrying\n", strerror(err));
+                 break;
+             }
+             // Record the new worker in the process table and watch for its exit
+             // (pool members are already watched; in-process workers report through the
+             // queue or finish inside oss).
+             processTable[slot].pidfd = -1;
+             if (launchBackend == LAUNCH_FORK || launchBackend == LAUNCH_VFORK || launchBackend == LAUNCH_SPAWN) {
+                 processTable[slot].pidfd = watchChild(pid);
+             }
+             processTable[slot].occupied = 1;
+             processTable[slot].pid = pid;
+             pidIndexInsert(pid, slot);
+             processTable[slot].startSeconds = simSec;
+             processTable[slot].startNano = simNano;
+             processTable[slot].arrival = job.release;
+             waitTotalNs += currentSimTime - job.release;
+             runningAppend(slot);
+             // The new worker runs until it arms its first deadline (a coroutine
+             // runs that far below, before oss moves on).
+             if (launchBackend != LAUNCH_CORO) {
+                 processTable[slot].awake = 1;
+                 awakeCount++;
+             }
+             launchedCount++;   // Increment the count of launched workers.
+             runningCount++;    // Increment the count of currently running workers.
+             if (runningCount > maxRunning) {
+                 maxRunning = runningCount;
+             }
+             statsSet(&stats->launched, launchedCount);
+             statsSet(&stats->running, runningCount);
+             // Update the last launch time to the current simulated time.
+             lastLaunchTime = currentSimTime;
+             // Accumulate the launch latency for the summary printed at exit.
+             launchLatencyTotalNs += launchNs;
+             if (launchNs > launchLatencyMaxNs) {
+                 launchLatencyMaxNs = launchNs;
+             }
+             ossLog("Launched worker PID %d at simulated time %d s, %d ns. (Worker will run for %d s and %d ns) [%s: %llu us]\n",
+                    pid, simSec, simNano, randSec, randNano,
+                    launchBackendNames[launchBackend], launchNs / 1000);
+             if (tracePath != NULL) {
+                 traceEmit(&trace, EV_LAUNCH, pid, slot, currentSimTime, randSec, randNano,
+                           launchNs > UINT32_MAX ? UINT32_MAX : launchNs, launchBackend);
+             }
+             if (launchBackend == LAUNCH_CORO) {
+                 coroResume(slot);
              }
          }
-         // Busy-loop: In a production system, a short usleep() might yield CPU time.
-         // However, we cannot sleep because we simulate time using our own clock.
+         if (phaseTiming && launching) {
+             phaseEnd(PHASE_LAUNCH, &phaseStart);
+         }
+         if (phaseTiming) {
+             histRecord(&phaseHist[PHASE_LOOP], phaseStart - loopStart);
+         }
+         // Without -R, the loop only blocks while workers are still reacting (in
+         // epoll_wait, in waitForQuiescence); otherwise it moves on at once. In the
+         // default mode, that makes it spin through every 1 ms tick as fast as the CPU
+         // allows. With -e, it takes one iteration per event instead. With -R, oss sleeps
+         // (clock_nanosleep to an absolute deadline) until the next step is due in real
+         // time. Workers sleep on their futex until woken above.
+     }
+ 
+     // Let the pool members exit now that every job has finished.
+     if (launchBackend == LAUNCH_POOL) {
+         stopPool();
+     }
+ 
+     if (phaseTiming) {
+         reportPhases();
+     }
+ 
+     // One-line summary of the whole run (read by osssweep).
+     ossLog("Run summary: simulated %.3f s, wall %.3f s, max concurrency %d, mean worker lifetime %.3f s, mean wait %.3f s, mean turnaround %.3f s\n",
+            clockNow(shmClock) / 1e9, (monotonicNs() - runStartNs) / 1e9, maxRunning,
+            reapedCount ? lifetimeTotalNs / 1e9 / reapedCount : 0.0,
+            launchedCount ? waitTotalNs / 1e9 / launchedCount : 0.0,
+            reapedCount ? turnaroundTotalNs / 1e9 / reapedCount : 0.0);
+ 
+     // Report the launch cost so backends can be compared.
+     if (launchedCount > 0) {
+         ossLog("Launch backend %s: %d launches, mean %llu us, max %llu us\n",
+                launchBackendNames[launchBackend], launchedCount,
+                launchLatencyTotalNs / launchedCount / 1000, launchLatencyMaxNs / 1000);
      }
   
-     // Cleanup: detach and remove shared memory before exiting.
-     shmdt(shmClock);
-     shmctl(shmid, IPC_RMID, NULL);
+     // Cleanup: write out the remaining output, then detach and remove shared memory.
+     stopLogWriter();
+     closeTrace();
+     closeStats();
+     replayClose(&replay);
+     // A thread worker that reported its last job may still be ringing the doorbell, so
+     // leave the segment to process exit under the thread backend.
+     if (launchBackend != LAUNCH_THREAD) {
+         munmap(shmClock, clockBytes);
+     }
+     close(clockFd);
      return 0;
  }
  
\ No newline at end of file
@@ -0,0 +1,320 @@
+/*
+ * ossbench.c
+ * Author: aqrabwi, 13/02/2025 (modified)
+ * Description: Benchmark harness for oss. Runs oss once (or -r times) per scenario with
+ *              tracing on and the periodic display off, then measures from the trace:
+ *                - launches per second of wall-clock time,
+ *                - launch-to-first-clock-read latency (oss starts launching a worker until
+ *                  the worker has read the clock and printed its first line),
+ *                - exit-to-reap latency (worker prints its termination line until oss
+ *                  notices it terminated),
+ *                - clock-update-to-observe latency (oss wakes a worker because the clock
+ *                  reached its deadline until the worker has read the new time),
+ *              each as p50/p99/p999 in microseconds. Results are written as CSV, one row
+ *              per scenario, so runs can be compared over time.
+ *
+ * Usage: ossbench [-h] [-r runs] [-o ossPath] [-- "oss options" ...]
+ *   Each scenario is one argument (after --) holding the oss options to run with, for
+ *   example "-e -b spawn -n 200 -s 20 -t 1 -i 0". Without scenarios a built-in set is run.
+ */
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <unistd.h>
+ #include <string.h>
+ #include <errno.h>
+ #include <fcntl.h>
+ #include <getopt.h>
+ #include <sys/wait.h>
+ #include "trace.h"
+
+ // Maximum number of options in one scenario.
+ #define MAX_SCENARIO_ARGS 32
+
+ // Scenarios run when none are given on the command line.
+ const char *defaultScenarios[] = {
+     "-e -b fork -n 200 -s 20 -t 1 -i 0",
+     "-e -b spawn -n 200 -s 20 -t 1 -i 0",
+     "-e -b pool -n 200 -s 20 -t 1 -i 0",
+     "-e -b spawn -n 1000 -s 100 -t 2 -i 1",
+     "-b spawn -n 50 -s 10 -t 1 -i 10",
+ };
+
+ // A growable array of latency samples in nanoseconds.
+ typedef struct {
+     unsigned long long *values;
+     size_t count;
+     size_t capacity;
+ } Samples;
+
+ // Per-slot state used to pair up the events of one job. Events from different
+ // processes can be claimed in either order, so each side waits for the other.
+ typedef struct {
+     unsigned long long launchWall;    // Wall time the pending launch began (0 if none).
+     unsigned long long startWall;     // Wall time of a start seen before its launch (0 if none).
+     unsigned long long terminateWall; // Wall time of the pending termination (0 if none).
+     unsigned long long wakeWall;      // Wall time of the pending wake (0 if none).
+     unsigned long long wakeSim;       // Simulated time of the pending wake.
+ } SlotState;
+
+ // Function to append one sample.
+ void addSample(Samples *samples, unsigned long long value) {
+     if (samples->count == samples->capacity) {
+         samples->capacity = samples->capacity ? samples->capacity * 2 : 1024;
+         samples->values = realloc(samples->values, samples->capacity * sizeof(unsigned long long));
+         if (samples->values == NULL) {
+             perror("ossbench: realloc");
+             exit(1);
+         }
+     }
+     samples->values[samples->count++] = value;
+ }
+
+ int compareSamples(const void *a, const void *b) {
+     unsigned long long x = *(const unsigned long long *) a;
+     unsigned long long y = *(const unsigned long long *) b;
+     return (x > y) - (x < y);
+ }
+
+ // Function to return the given percentile (0-100) of sorted samples in microseconds.
+ double percentileUs(const Samples *samples, double percentile) {
+     if (samples->count == 0) {
+         return 0.0;
+     }
+     size_t rank = (size_t) (percentile / 100.0 * samples->count + 0.999999);
+     if (rank < 1) {
+         rank = 1;
+     }
+     if (rank > samples->count) {
+         rank = samples->count;
+     }
+     return samples->values[rank - 1] / 1000.0;
+ }
+
+ // Function to return the current CLOCK_MONOTONIC time in nanoseconds.
+ unsigned long long monotonicNs() {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (unsigned long long) ts.tv_sec * ONE_BILLION + ts.tv_nsec;
+ }
+
+ // Function to run oss once with the given scenario, writing its trace to tracePath.
+ // Returns the wall-clock nanoseconds the run took, or 0 if oss failed.
+ unsigned long long runOss(const char *ossPath, const char *scenario, const char *tracePath) {
+     // Split the scenario into options. The display is turned off first so a scenario
+     // can still ask for it.
+     char *copy = strdup(scenario);
+     char *argv[MAX_SCENARIO_ARGS + 6];
+     int argc = 0;
+     argv[argc++] = (char *) ossPath;
+     argv[argc++] = "-v";
+     argv[argc++] = "0";
+     for (char *save, *tok = strtok_r(copy, " \t", &save); tok != NULL; tok = strtok_r(NULL, " \t", &save)) {
+         if (argc >= MAX_SCENARIO_ARGS + 3) {
+             fprintf(stderr, "ossbench: too many options in scenario \"%s\"\n", scenario);
+             exit(1);
+         }
+         argv[argc++] = tok;
+     }
+     argv[argc++] = "-T";
+     argv[argc++] = (char *) tracePath;
+     argv[argc] = NULL;
+
+     unsigned long long start = monotonicNs();
+     pid_t pid = fork();
+     if (pid < 0) {
+         perror("ossbench: fork");
+         exit(1);
+     }
+     if (pid == 0) {
+         // oss signals its whole process group when it aborts; keep ossbench out of it.
+         setpgid(0, 0);
+         // oss's regular output is not part of the measurement.
+         int devNull = open("/dev/null", O_WRONLY);
+         if (devNull != -1) {
+             dup2(devNull, STDOUT_FILENO);
+         }
+         execv(ossPath, argv);
+         perror("ossbench: exec oss");
+         _exit(127);
+     }
+     int status;
+     while (waitpid(pid, &status, 0) == -1 && errno == EINTR) {
+     }
+     unsigned long long elapsed = monotonicNs() - start;
+     free(copy);
+     if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+         fprintf(stderr, "ossbench: oss failed for scenario \"%s\"\n", scenario);
+         return 0;
+     }
+     return elapsed;
+ }
+
+ // Function to add the latencies found in one trace to the sample sets.
+ // Returns the number of launches in the trace.
+ int collectTrace(const char *tracePath, Samples *launch, Samples *reap, Samples *observe) {
+     TraceFile trace;
+     if (traceOpen(&trace, tracePath, TRACE_READ, 0) == -1) {
+         fprintf(stderr, "ossbench: %s: %s\n", tracePath, strerror(errno));
+         exit(1);
+     }
+     uint64_t count = traceCount(&trace);
+     // Slots are below the number of records, which bounds the state array.
+     int slots = 0;
+     for (uint64_t i = 0; i < count; i++) {
+         if (trace.records[i].slot >= slots) {
+             slots = trace.records[i].slot + 1;
+         }
+     }
+     SlotState *state = calloc(slots > 0 ? slots : 1, sizeof(SlotState));
+     if (state == NULL) {
+         perror("ossbench: calloc");
+         exit(1);
+     }
+     int launches = 0;
+     for (uint64_t i = 0; i < count; i++) {
+         const TraceRecord *rec = &trace.records[i];
+         if (rec->slot < 0) {
+             continue;
+         }
+         SlotState *s = &state[rec->slot];
+         unsigned long long sim = (unsigned long long) rec->simSec * ONE_BILLION + rec->simNano;
+         switch (rec->type) {
+             case EV_LAUNCH: {
+                 // The record is written after the launch returned; args[2] is how long it took.
+                 unsigned long long begin = rec->wallNs - rec->args[2];
+                 launches++;
+                 if (s->startWall) {
+                     addSample(launch, s->startWall > begin ? s->startWall - begin : 0);
+                     s->startWall = 0;
+                 } else {
+                     s->launchWall = begin;
+                 }
+                 break;
+             }
+             case EV_START:
+                 if (s->launchWall) {
+                     addSample(launch, rec->wallNs > s->launchWall ? rec->wallNs - s->launchWall : 0);
+                     s->launchWall = 0;
+                 } else {
+                     s->startWall = rec->wallNs;
+                 }
+                 break;
+             case EV_WAKE:
+                 s->wakeWall = rec->wallNs;
+                 s->wakeSim = sim;
+                 break;
+             case EV_STATUS:
+             case EV_TERMINATE: {
+                 // Only count observations caused by the pending wake: it must have happened
+                 // at or after the instant the worker was waiting for (the second boundary
+                 // for a status line, the target for termination) and not after what it read.
+                 unsigned long long awaited = (rec->type == EV_STATUS)
+                     ? (unsigned long long) rec->simSec * ONE_BILLION
+                     : (unsigned long long) rec->args[0] * ONE_BILLION + rec->args[1];
+                 if (s->wakeWall && s->wakeSim >= awaited && s->wakeSim <= sim && rec->wallNs >= s->wakeWall) {
+                     addSample(observe, rec->wallNs - s->wakeWall);
+                 }
+                 s->wakeWall = 0;
+                 if (rec->type == EV_TERMINATE) {
+                     s->terminateWall = rec->wallNs;
+                 }
+                 break;
+             }
+             case EV_REAP:
+                 if (s->terminateWall) {
+                     addSample(reap, rec->wallNs > s->terminateWall ? rec->wallNs - s->terminateWall : 0);
+                     s->terminateWall = 0;
+                 }
+                 break;
+         }
+     }
+     free(state);
+     traceClose(&trace);
+     return launches;
+ }
+
+ // Function to run one scenario and print its CSV row.
+ void benchScenario(const char *ossPath, const char *scenario, int runs, const char *tracePath) {
+     Samples launch = {0}, reap = {0}, observe = {0};
+     unsigned long long wallNs = 0;
+     long long launches = 0;
+     for (int run = 0; run < runs; run++) {
+         unsigned long long elapsed = runOss(ossPath, scenario, tracePath);
+         if (elapsed == 0) {
+             unlink(tracePath);
+             return;
+         }
+         wallNs += elapsed;
+         launches += collectTrace(tracePath, &launch, &reap, &observe);
+     }
+     unlink(tracePath);
+     qsort(launch.values, launch.count, sizeof(unsigned long long), compareSamples);
+     qsort(reap.values, reap.count, sizeof(unsigned long long), compareSamples);
+     qsort(observe.values, observe.count, sizeof(unsigned long long), compareSamples);
+     printf("\"%s\",%d,%lld,%.3f,%.1f", scenario, runs, launches, wallNs / 1e9,
+            wallNs ? launches / (wallNs / 1e9) : 0.0);
+     Samples *sets[] = {&launch, &reap, &observe};
+     for (int i = 0; i < 3; i++) {
+         printf(",%zu,%.1f,%.1f,%.1f", sets[i]->count, percentileUs(sets[i], 50),
+                percentileUs(sets[i], 99), percentileUs(sets[i], 99.9));
+         free(sets[i]->values);
+     }
+     printf("\n");
+     fflush(stdout);
+ }
+
+ int main(int argc, char *argv[]) {
+     int opt;
+     int runs = 1;
+     const char *ossPath = "./oss";
+     // Parse command-line options using getopt.
+     // Options:
+     //  -h: help
+     //  -r: runs per scenario (samples are pooled)
+     //  -o: path of the oss executable
+     while ((opt = getopt(argc, argv, "hr:o:")) != -1) {
+         switch (opt) {
+             case 'h':
+                 printf("Usage: %s [-r runs] [-o ossPath] [-- \"oss options\" ...]\n", argv[0]);
+                 exit(0);
+             case 'r':
+                 runs = atoi(optarg);
+                 break;
+             case 'o':
+                 ossPath = optarg;
+                 break;
+             default:
+                 fprintf(stderr, "Unknown option: %c\n", opt);
+                 exit(1);
+         }
+     }
+     if (runs < 1) {
+         fprintf(stderr, "Error: runs must be at least 1.\n");
+         exit(1);
+     }
+
+     char tracePath[] = "/tmp/ossbench.XXXXXX";
+     int fd = mkstemp(tracePath);
+     if (fd == -1) {
+         perror("ossbench: mkstemp");
+         exit(1);
+     }
+     close(fd);
+
+     printf("scenario,runs,launches,wall_s,launches_per_s,"
+            "launch_n,launch_p50_us,launch_p99_us,launch_p999_us,"
+            "reap_n,reap_p50_us,reap_p99_us,reap_p999_us,"
+            "observe_n,observe_p50_us,observe_p99_us,observe_p999_us\n");
+     fflush(stdout);
+     if (optind < argc) {
+         for (int i = optind; i < argc; i++) {
+             benchScenario(ossPath, argv[i], runs, tracePath);
+         }
+     } else {
+         for (size_t i = 0; i < sizeof(defaultScenarios) / sizeof(defaultScenarios[0]); i++) {
+             benchScenario(ossPath, defaultScenarios[i], runs, tracePath);
+         }
+     }
+     return 0;
+ }
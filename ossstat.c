@@ -0,0 +1,211 @@
+/*
+ * ossstat.c
+ * Author: aqrabwi, 13/02/2025 (modified)
+ * Description: Watches a running oss through its live statistics page, in the style of
+ *              vmstat: every interval it prints the simulated clock, the worker counters and
+ *              the rates since the previous line. The page is a memfd held by oss; ossstat
+ *              opens it through /proc/<pid>/fd and maps it read-only, so watching has no
+ *              effect on oss.
+ *
+ * Usage: ossstat [-h] [-p ossPid] [interval [count]]
+ *   -p ossPid Which oss to watch (default: the only oss running)
+ *   interval  Seconds between lines, fractions allowed (default: 1)
+ *   count     Number of lines to print (default: until oss finishes)
+ */
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <unistd.h>
+ #include <string.h>
+ #include <errno.h>
+ #include <signal.h>
+ #include <time.h>
+ #include <getopt.h>
+ #include <fcntl.h>
+ #include <dirent.h>
+ #include <limits.h>
+ #include <sys/mman.h>
+ #include "simclock.h"
+ #include "ossstats.h"
+
+ // Print the column header again after this many lines.
+ #define HEADER_EVERY 20
+ 
+ // Prefix of the /proc/<pid>/fd link of the statistics memfd.
+ #define STATS_LINK "/memfd:" STATS_NAME
+
+ // One sample of the counters.
+ typedef struct {
+     unsigned long long wallNs;
+     unsigned long long clockNano;
+     unsigned long long launched;
+     unsigned long long running;
+     unsigned long long reaped;
+     unsigned long long launchFailures;
+     unsigned long long loopIterations;
+ } Sample;
+
+ // Function to read every counter from the page.
+ void takeSample(const OssStats *stats, Sample *sample) {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     sample->wallNs = (unsigned long long) ts.tv_sec * ONE_BILLION + ts.tv_nsec;
+     sample->clockNano = statsGet(&stats->clockNano);
+     sample->launched = statsGet(&stats->launched);
+     sample->running = statsGet(&stats->running);
+     sample->reaped = statsGet(&stats->reaped);
+     sample->launchFailures = statsGet(&stats->launchFailures);
+     sample->loopIterations = statsGet(&stats->loopIterations);
+ }
+
+ // Function to print one line: totals of the current sample and rates since the previous one.
+ void printSample(const Sample *prev, const Sample *cur) {
+     double seconds = (cur->wallNs - prev->wallNs) / 1e9;
+     if (seconds <= 0) {
+         seconds = 1e-9;
+     }
+     printf("%12.3f %9llu %8llu %9llu %7llu %10.1f %10.1f %12.1f %10.3f\n",
+            cur->clockNano / 1e9, cur->launched, cur->running, cur->reaped, cur->launchFailures,
+            (cur->launched - prev->launched) / seconds, (cur->reaped - prev->reaped) / seconds,
+            (cur->loopIterations - prev->loopIterations) / seconds,
+            (cur->clockNano - prev->clockNano) / 1e9 / seconds);
+ }
+
+ // Function to find the PID of the only process named oss. Exits if there is none or
+ // more than one (then -p has to say which).
+ pid_t findOss() {
+     DIR *proc = opendir("/proc");
+     if (proc == NULL) {
+         perror("ossstat: /proc");
+         exit(1);
+     }
+     pid_t found = -1;
+     int matches = 0;
+     struct dirent *entry;
+     while ((entry = readdir(proc)) != NULL) {
+         pid_t pid = (pid_t) atoi(entry->d_name);
+         if (pid <= 0) {
+             continue;
+         }
+         char path[64], comm[32] = "";
+         snprintf(path, sizeof(path), "/proc/%d/comm", pid);
+         FILE *file = fopen(path, "r");
+         if (file == NULL) {
+             continue;
+         }
+         if (fgets(comm, sizeof(comm), file) != NULL && strcmp(comm, "oss\n") == 0) {
+             found = pid;
+             matches++;
+         }
+         fclose(file);
+     }
+     closedir(proc);
+     if (matches == 0) {
+         fprintf(stderr, "ossstat: no running oss\n");
+         exit(1);
+     }
+     if (matches > 1) {
+         fprintf(stderr, "ossstat: %d oss processes running, choose one with -p\n", matches);
+         exit(1);
+     }
+     return found;
+ }
+ 
+ // Function to open the statistics memfd among the descriptors of the given oss.
+ int openStats(pid_t pid) {
+     char dirPath[64];
+     snprintf(dirPath, sizeof(dirPath), "/proc/%d/fd", pid);
+     DIR *fds = opendir(dirPath);
+     if (fds == NULL) {
+         fprintf(stderr, "ossstat: %s: %s\n", dirPath, strerror(errno));
+         exit(1);
+     }
+     int fd = -1;
+     struct dirent *entry;
+     while (fd == -1 && (entry = readdir(fds)) != NULL) {
+         char path[PATH_MAX], target[PATH_MAX];
+         snprintf(path, sizeof(path), "%s/%s", dirPath, entry->d_name);
+         ssize_t len = readlink(path, target, sizeof(target) - 1);
+         if (len <= 0) {
+             continue;
+         }
+         target[len] = '\0';
+         if (strncmp(target, STATS_LINK, strlen(STATS_LINK)) == 0) {
+             fd = open(path, O_RDONLY);
+         }
+     }
+     closedir(fds);
+     if (fd == -1) {
+         fprintf(stderr, "ossstat: PID %d has no statistics page\n", pid);
+         exit(1);
+     }
+     return fd;
+ }
+ 
+ int main(int argc, char *argv[]) {
+     int opt;
+     pid_t ossPid = -1;
+     // Parse command-line options using getopt.
+     // Options:
+     //  -h: help
+     //  -p: PID of the oss to watch
+     while ((opt = getopt(argc, argv, "hp:")) != -1) {
+         switch (opt) {
+             case 'h':
+                 printf("Usage: %s [-p ossPid] [interval [count]]\n", argv[0]);
+                 exit(0);
+             case 'p':
+                 ossPid = (pid_t) atoi(optarg);
+                 break;
+             default:
+                 fprintf(stderr, "Unknown option: %c\n", opt);
+                 exit(1);
+         }
+     }
+     double interval = (optind < argc) ? atof(argv[optind]) : 1.0;
+     long count = (optind + 1 < argc) ? atol(argv[optind + 1]) : -1;
+     if (interval <= 0) {
+         fprintf(stderr, "Error: interval must be positive.\n");
+         exit(1);
+     }
+
+     // Map the statistics page of the chosen oss read-only.
+     if (ossPid == -1) {
+         ossPid = findOss();
+     }
+     int fd = openStats(ossPid);
+     size_t statsBytes;
+     const OssStats *stats = (const OssStats *) sharedAttach(fd, 1, &statsBytes);
+     close(fd);
+     if (stats == NULL || statsBytes < sizeof(OssStats)) {
+         perror("ossstat: statistics page");
+         exit(1);
+     }
+     if (__atomic_load_n(&stats->magic, __ATOMIC_ACQUIRE) != STATS_MAGIC) {
+         fprintf(stderr, "ossstat: statistics page not initialized\n");
+         exit(1);
+     }
+     printf("oss PID %d: %d workers, at most %d at once\n", stats->ossPid, stats->totalProcs, stats->simulLimit);
+
+     struct timespec pause = {(time_t) interval, (long) ((interval - (time_t) interval) * 1e9)};
+     Sample prev, cur;
+     takeSample(stats, &prev);
+     for (long line = 0; count < 0 || line < count; line++) {
+         if (line % HEADER_EVERY == 0) {
+             printf("%12s %9s %8s %9s %7s %10s %10s %12s %10s\n", "clock_s", "launched", "running",
+                    "reaped", "failed", "launch/s", "reap/s", "loops/s", "sim_s/s");
+         }
+         nanosleep(&pause, NULL);
+         takeSample(stats, &cur);
+         printSample(&prev, &cur);
+         fflush(stdout);
+         prev = cur;
+         // Stop once oss is done (or gone without saying so).
+         if (__atomic_load_n(&stats->finished, __ATOMIC_ACQUIRE)
+             || (kill(stats->ossPid, 0) == -1 && errno == ESRCH)) {
+             break;
+         }
+     }
+     munmap((void *) stats, statsBytes);
+     return 0;
+ }
@@ -0,0 +1,47 @@
+/*
+ * ossstats.h
+ * Author: aqrabwi, 13/02/2025 (modified)
+ * Description: Live statistics page oss publishes in its own shared memory object, next
+ *              to the clock segment. oss is the only writer and updates each counter with a
+ *              plain (relaxed atomic) store where it already keeps that counter, so
+ *              publishing costs no system call and no extra synchronization. The page is a
+ *              memfd named STATS_NAME that only oss holds; ossstat finds it among the open
+ *              descriptors of the oss it watches (/proc/<pid>/fd), maps it read-only and
+ *              samples it.
+ */
+
+ #ifndef OSSSTATS_H
+ #define OSSSTATS_H
+
+ // Name of the statistics memfd (shown as "/memfd:oss-stats (deleted)" in /proc/<pid>/fd).
+ #define STATS_NAME "oss-stats"
+
+ // Identifies an initialized statistics page.
+ #define STATS_MAGIC 0x5353544154535353ULL
+
+ // The statistics page. Every field is written by oss only.
+ typedef struct {
+     unsigned long long magic;          // STATS_MAGIC once oss has initialized the page.
+     int ossPid;                        // PID of the oss that owns the page.
+     int finished;                      // Set when oss is done (atomic).
+     int totalProcs;                    // -n
+     int simulLimit;                    // -s
+     unsigned long long launched;       // Workers launched so far (atomic).
+     unsigned long long running;        // Workers currently running (atomic).
+     unsigned long long reaped;         // Workers that terminated and were reaped (atomic).
+     unsigned long long launchFailures; // Launch attempts that failed (atomic).
+     unsigned long long clockNano;      // Simulated time in nanoseconds (atomic).
+     unsigned long long loopIterations; // Main loop iterations so far (atomic).
+ } OssStats;
+
+ // Publish a new value of one counter (oss only).
+ static inline void statsSet(unsigned long long *field, unsigned long long value) {
+     __atomic_store_n(field, value, __ATOMIC_RELAXED);
+ }
+
+ // Read one counter (ossstat).
+ static inline unsigned long long statsGet(const unsigned long long *field) {
+     return __atomic_load_n(field, __ATOMIC_RELAXED);
+ }
+
+ #endif
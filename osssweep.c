@@ -0,0 +1,253 @@
+/*
+ * osssweep.c
+ * Author: aqrabwi, 13/02/2025 (modified)
+ * Description: Parameter sweep runner. Runs oss once for every combination of the given
+ *              -n, -s, -t and -i values, keeping up to -j runs going at once (one per core
+ *              by default), and writes one CSV row per run with the figures from oss's
+ *              run summary: simulated time, wall time, maximum concurrency, mean worker
+ *              lifetime, and the mean wait and turnaround of the jobs. Each run is
+ *              independent (oss uses private shared memory), so runs on different cores
+ *              do not interfere.
+ *
+ * Usage: osssweep [-h] [-j jobs] [-o ossPath] [-x "oss options"] -n list -s list -t list -i list
+ *   list   Comma-separated values, e.g. -n 100,1000 -s 5,50
+ *   -j     Maximum number of oss runs at once (default: number of online CPUs)
+ *   -x     Options passed to every run, e.g. -x "-e -b spawn"
+ *   Any list left out uses oss's default for that option.
+ */
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <unistd.h>
+ #include <string.h>
+ #include <errno.h>
+ #include <time.h>
+ #include <fcntl.h>
+ #include <getopt.h>
+ #include <sys/wait.h>
+
+ // Maximum number of values in one list and of extra options.
+ #define MAX_VALUES 64
+ #define MAX_EXTRA_ARGS 32
+
+ // Bytes read from the end of a run's output when looking for the summary line.
+ #define SUMMARY_TAIL_BYTES 4096
+
+ // The swept options, in the order of the CSV columns.
+ const char swept[] = "nsti";
+ #define SWEPT_COUNT 4
+
+ // Value lists for the swept options (an empty list means "oss default").
+ typedef struct {
+     int values[MAX_VALUES];
+     int count;
+ } ValueList;
+
+ // One run of the grid.
+ typedef struct {
+     int params[SWEPT_COUNT];   // Value per swept option (-1 = oss default).
+     pid_t pid;                 // oss process while the run is going (0 otherwise).
+     char outputPath[32];       // Temporary file holding oss's output.
+     unsigned long long startNs;
+ } Run;
+
+ ValueList lists[SWEPT_COUNT];
+ char *extraArgs[MAX_EXTRA_ARGS];
+ int extraCount = 0;
+ const char *ossPath = "./oss";
+
+ // Function to parse a comma-separated list of non-negative integers.
+ void parseList(ValueList *list, char *text, char option) {
+     list->count = 0;
+     for (char *save, *tok = strtok_r(text, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save)) {
+         if (list->count == MAX_VALUES) {
+             fprintf(stderr, "osssweep: too many values for -%c\n", option);
+             exit(1);
+         }
+         list->values[list->count++] = atoi(tok);
+     }
+ }
+
+ // Function to return the current CLOCK_MONOTONIC time in nanoseconds.
+ unsigned long long monotonicNs() {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+ }
+
+ // Function to start oss for one run, with its output going to a temporary file.
+ void startRun(Run *run) {
+     strcpy(run->outputPath, "/tmp/osssweep.XXXXXX");
+     int outFd = mkstemp(run->outputPath);
+     if (outFd == -1) {
+         perror("osssweep: mkstemp");
+         exit(1);
+     }
+     char values[SWEPT_COUNT][16];
+     char flags[SWEPT_COUNT][3];
+     char *argv[2 * SWEPT_COUNT + MAX_EXTRA_ARGS + 4];
+     int argc = 0;
+     argv[argc++] = (char *) ossPath;
+     argv[argc++] = "-v";
+     argv[argc++] = "0";
+     for (int i = 0; i < extraCount; i++) {
+         argv[argc++] = extraArgs[i];
+     }
+     for (int i = 0; i < SWEPT_COUNT; i++) {
+         if (run->params[i] >= 0) {
+             snprintf(flags[i], sizeof(flags[i]), "-%c", swept[i]);
+             snprintf(values[i], sizeof(values[i]), "%d", run->params[i]);
+             argv[argc++] = flags[i];
+             argv[argc++] = values[i];
+         }
+     }
+     argv[argc] = NULL;
+
+     run->startNs = monotonicNs();
+     run->pid = fork();
+     if (run->pid < 0) {
+         perror("osssweep: fork");
+         exit(1);
+     }
+     if (run->pid == 0) {
+         // oss signals its whole process group when it aborts; give each run its own.
+         setpgid(0, 0);
+         dup2(outFd, STDOUT_FILENO);
+         execv(ossPath, argv);
+         perror("osssweep: exec oss");
+         _exit(127);
+     }
+     close(outFd);
+ }
+
+ // Function to print the CSV row of a finished run and remove its output.
+ void finishRun(Run *run, int status) {
+     double simSeconds = 0, wallSeconds = 0, lifetime = 0, wait = 0, turnaround = 0;
+     int maxConcurrency = 0;
+     int found = 0;
+     // The summary is among the last lines oss prints.
+     int fd = open(run->outputPath, O_RDONLY);
+     if (fd != -1) {
+         char tail[SUMMARY_TAIL_BYTES + 1];
+         off_t size = lseek(fd, 0, SEEK_END);
+         off_t from = size > SUMMARY_TAIL_BYTES ? size - SUMMARY_TAIL_BYTES : 0;
+         ssize_t len = pread(fd, tail, SUMMARY_TAIL_BYTES, from);
+         close(fd);
+         tail[len > 0 ? len : 0] = '\0';
+         char *line = strstr(tail, "Run summary:");
+         if (line != NULL) {
+             found = sscanf(line, "Run summary: simulated %lf s, wall %lf s, max concurrency %d, mean worker lifetime %lf s, mean wait %lf s, mean turnaround %lf s",
+                            &simSeconds, &wallSeconds, &maxConcurrency, &lifetime, &wait, &turnaround) == 6;
+         }
+     }
+     unlink(run->outputPath);
+     if (!found) {
+         // No summary: oss failed; report the wall time we measured ourselves.
+         wallSeconds = (monotonicNs() - run->startNs) / 1e9;
+     }
+     const char *result = found && WIFEXITED(status) && WEXITSTATUS(status) == 0 ? "ok" : "failed";
+     for (int i = 0; i < SWEPT_COUNT; i++) {
+         if (run->params[i] >= 0) {
+             printf("%d,", run->params[i]);
+         } else {
+             printf(",");
+         }
+     }
+     printf("%.3f,%.3f,%d,%.3f,%.3f,%.3f,%s\n", simSeconds, wallSeconds, maxConcurrency, lifetime, wait, turnaround, result);
+     fflush(stdout);
+     run->pid = 0;
+ }
+
+ int main(int argc, char *argv[]) {
+     int opt;
+     long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+     // Parse command-line options using getopt.
+     // Options:
+     //  -h: help
+     //  -j: maximum concurrent runs
+     //  -o: path of the oss executable
+     //  -x: options for every run
+     //  -n, -s, -t, -i: value lists to sweep
+     while ((opt = getopt(argc, argv, "hj:o:x:n:s:t:i:")) != -1) {
+         switch (opt) {
+             case 'h':
+                 printf("Usage: %s [-j jobs] [-o ossPath] [-x \"oss options\"] -n list -s list -t list -i list\n", argv[0]);
+                 exit(0);
+             case 'j':
+                 jobs = atol(optarg);
+                 break;
+             case 'o':
+                 ossPath = optarg;
+                 break;
+             case 'x':
+                 for (char *save, *tok = strtok_r(optarg, " \t", &save); tok != NULL; tok = strtok_r(NULL, " \t", &save)) {
+                     if (extraCount == MAX_EXTRA_ARGS) {
+                         fprintf(stderr, "osssweep: too many options in -x\n");
+                         exit(1);
+                     }
+                     extraArgs[extraCount++] = tok;
+                 }
+                 break;
+             case 'n':
+             case 's':
+             case 't':
+             case 'i':
+                 parseList(&lists[strchr(swept, opt) - swept], optarg, opt);
+                 break;
+             default:
+                 fprintf(stderr, "Unknown option: %c\n", opt);
+                 exit(1);
+         }
+     }
+     if (jobs < 1) {
+         jobs = 1;
+     }
+
+     // Build the grid: every combination of the listed values.
+     int total = 1;
+     for (int i = 0; i < SWEPT_COUNT; i++) {
+         total *= lists[i].count > 0 ? lists[i].count : 1;
+     }
+     Run *runs = calloc(total, sizeof(Run));
+     if (runs == NULL) {
+         perror("osssweep: calloc");
+         exit(1);
+     }
+     for (int r = 0; r < total; r++) {
+         int index = r;
+         for (int i = SWEPT_COUNT - 1; i >= 0; i--) {
+             int count = lists[i].count > 0 ? lists[i].count : 1;
+             runs[r].params[i] = lists[i].count > 0 ? lists[i].values[index % count] : -1;
+             index /= count;
+         }
+     }
+
+     // Keep up to `jobs` runs going; rows are printed in the order runs finish.
+     printf("n,s,t,i,sim_s,wall_s,max_concurrency,mean_lifetime_s,mean_wait_s,mean_turnaround_s,result\n");
+     fflush(stdout);
+     int next = 0, active = 0;
+     while (next < total || active > 0) {
+         while (next < total && active < jobs) {
+             startRun(&runs[next++]);
+             active++;
+         }
+         int status;
+         pid_t pid = wait(&status);
+         if (pid == -1) {
+             if (errno == EINTR) {
+                 continue;
+             }
+             perror("osssweep: wait");
+             exit(1);
+         }
+         for (int r = 0; r < next; r++) {
+             if (runs[r].pid == pid) {
+                 finishRun(&runs[r], status);
+                 active--;
+                 break;
+             }
+         }
+     }
+     free(runs);
+     return 0;
+ }
@@ -0,0 +1,204 @@
+/*
+ * policy.h
+ * Author: aqrabwi, 13/02/2025 (modified)
+ * Description: Launch scheduling policies for oss (-p) and the pending-job queue they
+ *              choose from. Under sjf and edf, jobs that have arrived but not been launched
+ *              wait in the queue, a min-heap ordered by a key the policy sets when the job
+ *              arrives (its runtime or deadline), with ties broken by arrival order. The
+ *              other policies launch in arrival order, so oss takes their jobs straight
+ *              from the replay file or the generators and the queue only ever holds a job
+ *              put back after a failed launch. A token bucket can additionally limit the
+ *              launch rate.
+ */
+
+ #ifndef POLICY_H
+ #define POLICY_H
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+
+ // Deadline of a job under edf, in multiples of its runtime after its arrival (default).
+ #define DEFAULT_EDF_FACTOR 2.0
+
+ // Most jobs sjf and edf keep waiting in the queue (about 10 MiB). Jobs that arrive
+ // while it is full stay in the replay file or generators, in arrival order, until there
+ // is room, so a huge backlog is chosen from in windows of this many jobs.
+ #define PENDING_LIMIT (1 << 18)
+
+ // Launch policies, selected with -p.
+ typedef enum {
+     POLICY_INTERVAL, // No backlog: a job arrives only once the previous one launched.
+     POLICY_FIFO,     // Every job arrives on schedule and waits its turn in arrival order (default).
+     POLICY_SJF,      // Shortest job first among the waiting jobs.
+     POLICY_EDF,      // Earliest deadline first (deadline = arrival + FACTOR x runtime).
+     POLICY_TOKEN     // Arrival order, at most RATE launches per simulated second (bursts of BURST).
+ } SchedPolicy;
+
+ // Names accepted by -p, indexed by SchedPolicy.
+ static const char *policyNames[] = {"interval", "fifo", "sjf", "edf", "tb"};
+
+ // A job that has arrived and waits to be launched.
+ typedef struct {
+     unsigned long long key;       // Queue order (smallest first).
+     unsigned long long seq;       // Arrival number, breaks ties.
+     unsigned long long release;   // Simulated arrival time (ns).
+     unsigned long long deadline;  // Simulated deadline (ns, edf).
+     int sec;                      // Runtime.
+     int nano;
+ } PendingJob;
+
+ // The pending-job queue (grown on demand).
+ typedef struct {
+     PendingJob *jobs;
+     int size;
+     int capacity;
+ } PendingQueue;
+
+ // A token bucket: tokens accrue at `rate` per simulated second up to `burst`. The
+ // bucket is kept as simulated nanoseconds of credit (one token is `cost` ns), so the
+ // same launches happen whether the clock ticks or jumps between events.
+ typedef struct {
+     unsigned long long cost;      // Credit one token takes (ns).
+     unsigned long long limit;     // Most credit the bucket holds (burst tokens).
+     unsigned long long credit;
+     unsigned long long updated;   // Simulated time credit was last added (ns).
+ } TokenBucket;
+
+ // Whether a policy chooses among the waiting jobs (and so needs them in the queue).
+ static inline int policyQueues(SchedPolicy policy) {
+     return policy == POLICY_SJF || policy == POLICY_EDF;
+ }
+
+ // Whether job a goes before job b.
+ static inline int pendingBefore(const PendingJob *a, const PendingJob *b) {
+     return a->key < b->key || (a->key == b->key && a->seq < b->seq);
+ }
+
+ // Function to add a job to the queue, sifting it up to its place.
+ // Returns -1 if the queue could not grow.
+ static inline int pendingPush(PendingQueue *queue, const PendingJob *job) {
+     if (queue->size == queue->capacity) {
+         int capacity = queue->capacity ? queue->capacity * 2 : 64;
+         PendingJob *jobs = realloc(queue->jobs, capacity * sizeof(PendingJob));
+         if (jobs == NULL) {
+             return -1;
+         }
+         queue->jobs = jobs;
+         queue->capacity = capacity;
+     }
+     int i = queue->size++;
+     while (i > 0 && pendingBefore(job, &queue->jobs[(i - 1) / 2])) {
+         queue->jobs[i] = queue->jobs[(i - 1) / 2];
+         i = (i - 1) / 2;
+     }
+     queue->jobs[i] = *job;
+     return 0;
+ }
+
+ // Function to remove the first job of a non-empty queue into *job.
+ static inline void pendingPop(PendingQueue *queue, PendingJob *job) {
+     *job = queue->jobs[0];
+     PendingJob last = queue->jobs[--queue->size];
+     int i = 0;
+     while (2 * i + 1 < queue->size) {
+         int child = 2 * i + 1;
+         if (child + 1 < queue->size && pendingBefore(&queue->jobs[child + 1], &queue->jobs[child])) {
+             child++;
+         }
+         if (!pendingBefore(&queue->jobs[child], &last)) {
+             break;
+         }
+         queue->jobs[i] = queue->jobs[child];
+         i = child;
+     }
+     queue->jobs[i] = last;
+ }
+
+ /*
+  * policyParse - Parse a -p specification such as "edf:3" or "tb:20:5".
+  * @text: Policy name, followed by its parameters separated by ':'.
+  * @policy: Set to the policy.
+  * @params: Set to its parameters (edf: FACTOR; tb: RATE and BURST, burst 1 by default).
+  *
+  * Returns 0 on success, or -1 for an unknown name or invalid parameters.
+  */
+ static inline int policyParse(const char *text, SchedPolicy *policy, double params[2]) {
+     char copy[128];
+     snprintf(copy, sizeof(copy), "%s", text);
+     char *save, *name = strtok_r(copy, ":", &save);
+     int count = 0;
+     for (char *tok = strtok_r(NULL, ":", &save); tok != NULL; tok = strtok_r(NULL, ":", &save)) {
+         if (count == 2) {
+             return -1;
+         }
+         params[count++] = atof(tok);
+     }
+     for (int i = 0; i <= POLICY_TOKEN; i++) {
+         if (name == NULL || strcmp(name, policyNames[i]) != 0) {
+             continue;
+         }
+         *policy = (SchedPolicy) i;
+         switch (*policy) {
+             case POLICY_EDF:
+                 if (count == 0) {
+                     params[0] = DEFAULT_EDF_FACTOR;
+                 }
+                 return (count <= 1 && params[0] >= 0) ? 0 : -1;
+             case POLICY_TOKEN:
+                 if (count == 1) {
+                     params[1] = 1;
+                 }
+                 return (count >= 1 && params[0] > 0 && params[1] >= 1) ? 0 : -1;
+             default:
+                 return count == 0 ? 0 : -1;
+         }
+     }
+     return -1;
+ }
+
+ // Function to start a full token bucket.
+ static inline void tokenInit(TokenBucket *bucket, double rate, double burst) {
+     bucket->cost = (unsigned long long) (1e9 / rate);
+     if (bucket->cost == 0) {
+         bucket->cost = 1;
+     }
+     bucket->limit = bucket->cost * (unsigned long long) burst;
+     bucket->credit = bucket->limit;
+     bucket->updated = 0;
+ }
+
+ // Function to add the credit accrued up to simulated time `now`.
+ static inline void tokenRefill(TokenBucket *bucket, unsigned long long now) {
+     if (now > bucket->updated) {
+         bucket->credit += now - bucket->updated;
+         if (bucket->credit > bucket->limit) {
+             bucket->credit = bucket->limit;
+         }
+         bucket->updated = now;
+     }
+ }
+
+ // Function to take a token; returns 0 if the bucket holds none.
+ static inline int tokenTake(TokenBucket *bucket) {
+     if (bucket->credit < bucket->cost) {
+         return 0;
+     }
+     bucket->credit -= bucket->cost;
+     return 1;
+ }
+
+ // Function to give back a token that was not used.
+ static inline void tokenReturn(TokenBucket *bucket) {
+     bucket->credit += bucket->cost;
+ }
+
+ // Simulated time at which the bucket next holds a whole token.
+ static inline unsigned long long tokenReadyAt(const TokenBucket *bucket) {
+     if (bucket->credit >= bucket->cost) {
+         return bucket->updated;
+     }
+     return bucket->updated + (bucket->cost - bucket->credit);
+ }
+
+ #endif
@@ -0,0 +1,173 @@
+/*
+ * replay.h
+ * Author: aqrabwi, 13/02/2025 (modified)
+ * Description: Reader for job replay files (oss -r): recorded job arrivals, each with the
+ *              simulated time the job arrived and how long it ran. The file is mapped
+ *              read-only and parsed in place as oss launches jobs, so a replay of any size
+ *              needs no memory beyond the pages being read: parsed pages are handed back
+ *              to the kernel every REPLAY_DROP_BYTES.
+ *
+ * Format: one job per line, four integers separated by blanks:
+ *   arrivalSec arrivalNano durationSec durationNano
+ * in order of arrival. Empty lines and lines starting with '#' are skipped.
+ */
+
+ #ifndef REPLAY_H
+ #define REPLAY_H
+
+ #include <string.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include "simclock.h"
+
+ // Parsed bytes are released from the mapping in steps of this size.
+ #define REPLAY_DROP_BYTES (64UL << 20)
+
+ // One recorded job.
+ typedef struct {
+     unsigned long long arrival;   // Simulated arrival time (ns).
+     int sec;                      // Runtime.
+     int nano;
+ } ReplayJob;
+
+ // An open replay file and the parsing position in it.
+ typedef struct {
+     const char *data;      // Read-only mapping of the whole file (NULL when empty).
+     size_t size;
+     size_t pos;            // Next byte to parse.
+     size_t dropped;        // Bytes before this have been released.
+     long line;             // Line number of pos (for error messages).
+ } ReplayFile;
+
+ // Function to release the pages below the parsing position (only whole pages).
+ static inline void replayDrop(ReplayFile *rf, size_t upTo) {
+     size_t end = upTo & ~((size_t) sysconf(_SC_PAGESIZE) - 1);
+     if (end > rf->dropped) {
+         madvise((char *) rf->data + rf->dropped, end - rf->dropped, MADV_DONTNEED);
+         rf->dropped = end;
+     }
+ }
+
+ /*
+  * replayOpen - Map a replay file and count its jobs.
+  * @rf: Reader to set up.
+  * @path: Replay file.
+  * @jobs: Set to the number of job lines (lines starting with a digit).
+  *
+  * Counting is one sequential pass over the mapping, releasing pages as it goes.
+  * Returns 0 on success or -1 with errno set.
+  */
+ static inline int replayOpen(ReplayFile *rf, const char *path, unsigned long long *jobs) {
+     memset(rf, 0, sizeof(*rf));
+     rf->line = 1;
+     *jobs = 0;
+     int fd = open(path, O_RDONLY);
+     if (fd == -1) {
+         return -1;
+     }
+     struct stat st;
+     if (fstat(fd, &st) == -1) {
+         close(fd);
+         return -1;
+     }
+     rf->size = st.st_size;
+     if (rf->size > 0) {
+         void *map = mmap(NULL, rf->size, PROT_READ, MAP_PRIVATE, fd, 0);
+         if (map == MAP_FAILED) {
+             close(fd);
+             return -1;
+         }
+         rf->data = map;
+         madvise(map, rf->size, MADV_SEQUENTIAL);
+     }
+     close(fd);
+
+     for (size_t pos = 0; pos < rf->size; ) {
+         if (rf->data[pos] >= '0' && rf->data[pos] <= '9') {
+             (*jobs)++;
+         }
+         const char *newline = memchr(rf->data + pos, '\n', rf->size - pos);
+         pos = newline ? (size_t) (newline - rf->data) + 1 : rf->size;
+         if (pos - rf->dropped >= REPLAY_DROP_BYTES) {
+             replayDrop(rf, pos);
+         }
+     }
+     // Parsing starts over from the beginning; the released pages are read back in.
+     rf->dropped = 0;
+     return 0;
+ }
+
+ // Function to parse one unsigned integer at the position, skipping blanks before it.
+ // Returns 0 if there is no number before the end of the line.
+ static inline int replayNumber(ReplayFile *rf, unsigned long long *value) {
+     while (rf->pos < rf->size && (rf->data[rf->pos] == ' ' || rf->data[rf->pos] == '\t')) {
+         rf->pos++;
+     }
+     if (rf->pos == rf->size || rf->data[rf->pos] < '0' || rf->data[rf->pos] > '9') {
+         return 0;
+     }
+     *value = 0;
+     while (rf->pos < rf->size && rf->data[rf->pos] >= '0' && rf->data[rf->pos] <= '9') {
+         *value = *value * 10 + (rf->data[rf->pos++] - '0');
+     }
+     return 1;
+ }
+
+ /*
+  * replayNext - Parse the next job.
+  * @rf: Reader.
+  * @job: Set to the job.
+  *
+  * Returns 1 for a job, 0 at the end of the file, or -1 for a malformed line (its number
+  * is left in rf->line).
+  */
+ static inline int replayNext(ReplayFile *rf, ReplayJob *job) {
+     while (rf->pos < rf->size) {
+         char first = rf->data[rf->pos];
+         if (first == '#' || first == '\n' || first == '\r') {
+             // Skip a comment or empty line.
+             const char *newline = memchr(rf->data + rf->pos, '\n', rf->size - rf->pos);
+             rf->pos = newline ? (size_t) (newline - rf->data) + 1 : rf->size;
+             rf->line++;
+             continue;
+         }
+         // Job lines start with their first number (replayOpen counted them that way).
+         unsigned long long arrivalSec, arrivalNano, sec, nano;
+         if (first < '0' || first > '9' || !replayNumber(rf, &arrivalSec) || !replayNumber(rf, &arrivalNano) ||
+             !replayNumber(rf, &sec) || !replayNumber(rf, &nano) ||
+             arrivalNano >= ONE_BILLION || nano >= ONE_BILLION || sec > 0x7fffffff) {
+             return -1;
+         }
+         // Only blanks may follow on the line.
+         while (rf->pos < rf->size && rf->data[rf->pos] != '\n') {
+             char c = rf->data[rf->pos++];
+             if (c != ' ' && c != '\t' && c != '\r') {
+                 return -1;
+             }
+         }
+         if (rf->pos < rf->size) {
+             rf->pos++;
+         }
+         rf->line++;
+         job->arrival = arrivalSec * ONE_BILLION + arrivalNano;
+         job->sec = (int) sec;
+         job->nano = (int) nano;
+         if (rf->pos - rf->dropped >= REPLAY_DROP_BYTES) {
+             replayDrop(rf, rf->pos);
+         }
+         return 1;
+     }
+     return 0;
+ }
+
+ // Function to unmap a replay file.
+ static inline void replayClose(ReplayFile *rf) {
+     if (rf->data != NULL) {
+         munmap((void *) rf->data, rf->size);
+         rf->data = NULL;
+     }
+ }
+
+ #endif
@@ -0,0 +1,54 @@
+/*
+ * rng.h
+ * Author: aqrabwi, 13/02/2025 (modified)
+ * Description: Seeded pseudo-random numbers for oss's workload (SplitMix64). The generator
+ *              is counter-based: draw k of a stream is a fixed mix of the seed and k, so a
+ *              seed always yields the same sequence, independent of the C library, the
+ *              launch backend or anything else the process does (unlike rand(), whose
+ *              state is hidden and shared). A draw is an add and three multiply-xorshifts.
+ */
+
+ #ifndef RNG_H
+ #define RNG_H
+
+ #include <stdint.h>
+
+ // Increment between counter values (2^64 divided by the golden ratio).
+ #define RNG_GAMMA 0x9e3779b97f4a7c15ULL
+
+ typedef struct {
+     uint64_t seed;      // Selects the stream.
+     uint64_t counter;   // Draws taken so far.
+ } Rng;
+
+ // Start the stream of the given seed.
+ static inline void rngInit(Rng *rng, uint64_t seed) {
+     rng->seed = seed;
+     rng->counter = 0;
+ }
+
+ // Value number `index` of the stream of `seed` (the SplitMix64 output function).
+ static inline uint64_t rngAt(uint64_t seed, uint64_t index) {
+     uint64_t z = seed + (index + 1) * RNG_GAMMA;
+     z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+     z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+     return z ^ (z >> 31);
+ }
+
+ // Next 64 random bits.
+ static inline uint64_t rngNext(Rng *rng) {
+     return rngAt(rng->seed, rng->counter++);
+ }
+
+ // Map 64 random bits to a uniform value in [0, bound) for bound < 2^32, by multiplying
+ // instead of taking a remainder (no division, and no bias worth measuring at these bounds).
+ static inline uint32_t rngScale(uint64_t bits, uint32_t bound) {
+     return (uint32_t) (((bits >> 32) * (uint64_t) bound) >> 32);
+ }
+
+ // Uniform value in [0, bound) from the next draw.
+ static inline uint32_t rngBelow(Rng *rng, uint32_t bound) {
+     return rngScale(rngNext(rng), bound);
+ }
+
+ #endif
@@ -0,0 +1,74 @@
+/*
+ * seqqueue.h
+ * Author: aqrabwi, 13/02/2025 (modified)
+ * Description: Sequence-number protocol of a bounded multi-producer queue (D. Vyukov),
+ *              shared by the deadline registration queue in simclock.h and the log ring in
+ *              logring.h. Every cell starts with a sequence number saying whose turn the cell
+ *              is: a cell free for position p holds p, a filled one p + 1, and the consumer
+ *              hands it back for the next lap as p + size. Producers claim a position with
+ *              one compare-and-swap on the shared head; the single consumer owns the tail.
+ *              What a cell carries after its sequence number is up to the queue using it.
+ */
+
+ #ifndef SEQQUEUE_H
+ #define SEQQUEUE_H
+
+ #include <stddef.h>
+
+ // Sequence number of the cell for position pos. The queue holds mask + 1 cells, `stride`
+ // bytes apart, each starting with its sequence number.
+ static inline unsigned long long *seqQueueCell(void *cells, size_t stride, unsigned long long mask,
+                                                unsigned long long pos) {
+     return (unsigned long long *) ((char *) cells + (size_t) (pos & mask) * stride);
+ }
+
+ // Number every cell for the first lap (before anyone uses the queue).
+ static inline void seqQueueInit(void *cells, size_t stride, unsigned long long mask) {
+     for (unsigned long long i = 0; i <= mask; i++) {
+         *seqQueueCell(cells, stride, mask, i) = i;
+     }
+ }
+
+ // Claim the next position for a producer. Returns the claimed cell, with its position in
+ // *pos, or NULL if the queue is full.
+ static inline void *seqQueueClaim(unsigned long long *head, void *cells, size_t stride,
+                                   unsigned long long mask, unsigned long long *pos) {
+     unsigned long long p = __atomic_load_n(head, __ATOMIC_RELAXED);
+     for (;;) {
+         unsigned long long *seq = seqQueueCell(cells, stride, mask, p);
+         long long diff = (long long) (__atomic_load_n(seq, __ATOMIC_ACQUIRE) - p);
+         if (diff == 0) {
+             // The cell is free for this position; try to claim it.
+             if (__atomic_compare_exchange_n(head, &p, p + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                 *pos = p;
+                 return seq;
+             }
+         } else if (diff < 0) {
+             // The consumer has not handed the cell back from the previous lap.
+             return NULL;
+         } else {
+             // Another producer took this position first.
+             p = __atomic_load_n(head, __ATOMIC_RELAXED);
+         }
+     }
+ }
+
+ // Hand a claimed cell, once filled, to the consumer.
+ static inline void seqQueuePublish(void *cell, unsigned long long pos) {
+     __atomic_store_n((unsigned long long *) cell, pos + 1, __ATOMIC_RELEASE);
+ }
+
+ // The cell at the consumer's tail if it has been published, else NULL (consumer only).
+ static inline void *seqQueuePeek(void *cells, size_t stride, unsigned long long mask,
+                                  unsigned long long tail) {
+     unsigned long long *seq = seqQueueCell(cells, stride, mask, tail);
+     return __atomic_load_n(seq, __ATOMIC_ACQUIRE) == tail + 1 ? seq : NULL;
+ }
+
+ // Give the cell at the tail back to the producers for the next lap (consumer only); the
+ // consumer then advances its tail.
+ static inline void seqQueueRelease(void *cell, unsigned long long tail, unsigned long long mask) {
+     __atomic_store_n((unsigned long long *) cell, tail + mask + 1, __ATOMIC_RELEASE);
+ }
+
+ #endif
@@ -0,0 +1,258 @@
+/*
+ * simclock.h
+ * Author: aqrabwi, 13/02/2025 (modified)
+ * Description: Layout of the simulated system clock shared between oss and worker.
+ *              The clock is a single 64-bit nanosecond counter that oss (the only writer)
+ *              updates atomically, so readers always see a time that actually existed.
+ *              The seconds/nanoseconds view used for printing is derived from that counter.
+ *              The segment also holds one wait slot per process table entry: a worker publishes
+ *              the next simulated time it cares about and sleeps on a futex until oss wakes it.
+ *              Workers announce a newly armed deadline by pushing their slot number onto a
+ *              bounded multi-producer queue (after the wait slots) that oss drains into its
+ *              deadline heap, so oss never has to scan the table to find expired workers.
+ *              Pre-started pool workers also receive their jobs through a mailbox in their
+ *              wait slot and report finished jobs through the same queue.
+ *              Every shared segment is an anonymous memfd rather than a fixed SysV key: workers
+ *              inherit the descriptor and find its number in the environment, so any number of
+ *              oss instances can run side by side and nothing outlives the processes using it.
+ */
+
+ #ifndef SIMCLOCK_H
+ #define SIMCLOCK_H
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <unistd.h>
+ #include <time.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <sys/syscall.h>
+ #include <linux/futex.h>
+ #include <linux/memfd.h>
+ #include "seqqueue.h"
+
+ // Environment variable through which oss passes the clock segment's descriptor to workers.
+ #define CLOCK_FD_ENV "OSS_CLOCK_FD"
+ 
+ // Nanosecond conversion.
+ #define ONE_BILLION 1000000000ULL
+
+ // Deadline value meaning "this slot is not waiting for anything".
+ #define NO_DEADLINE (~0ULL)
+ 
+ // Kinds of events workers report through the registration queue.
+ #define REG_DEADLINE 0   // The slot armed a new deadline.
+ #define REG_DONE 1       // The pool worker in the slot finished its job.
+ 
+ // Job seconds value telling a pool worker to exit instead of running a job.
+ #define JOB_EXIT -1
+
+ // Per-worker wait slot. The worker stores its next deadline and sleeps on wakeWord;
+ // oss clears the deadline, bumps wakeWord and issues a futex wake once the clock reaches it.
+ typedef struct {
+     unsigned long long deadline;  // Simulated ns the worker wants to be woken at (atomic).
+     unsigned int wakeWord;        // Futex word, incremented by oss on every wakeup (atomic).
+     unsigned int jobWord;         // Pool mailbox futex word, incremented per posted job (atomic).
+     int jobSec;                   // Pool mailbox: seconds the posted job runs for.
+     int jobNano;                  // Pool mailbox: nanoseconds the posted job runs for.
+ } WaitSlot;
+
+ // One cell of the deadline registration queue (seqqueue.h, with oss as the consumer).
+ typedef struct {
+     unsigned long long seq;    // Sequence number of the cell (atomic, must come first).
+     int slot;                  // Wait slot the event is about.
+     int event;                 // REG_DEADLINE or REG_DONE.
+ } RegCell;
+
+ // Structure stored in the shared memory segment.
+ typedef struct {
+     unsigned long long nano;   // Total simulated nanoseconds since oss started (atomic).
+     int capacity;              // Number of entries in waits[].
+     unsigned int regMask;      // Registration queue size minus one (size is a power of two).
+     unsigned long long regHead;  // Next queue position producers claim (atomic).
+     unsigned long long regTail;  // Next queue position oss consumes (only oss touches it).
+     int ossSleeping;           // Set while oss blocks waiting for workers (atomic).
+     int doorbellFd;            // eventfd (inherited by workers) that wakes a sleeping oss.
+     WaitSlot waits[];          // One wait slot per process table entry, then the queue cells.
+ } SimClock;
+
+ // Number of registration queue cells for a table of the given size: every worker has
+ // at most one outstanding registration, so twice the table rounded up to a power of two.
+ static inline unsigned int clockRegQueueSize(int capacity) {
+     unsigned int size = 64;
+     while (size < 2U * (unsigned int) capacity) {
+         size <<= 1;
+     }
+     return size;
+ }
+
+ // Size in bytes of a clock segment holding the given number of wait slots.
+ static inline size_t clockSegmentSize(int capacity) {
+     return sizeof(SimClock) + (size_t) capacity * sizeof(WaitSlot)
+            + (size_t) clockRegQueueSize(capacity) * sizeof(RegCell);
+ }
+
+ // The registration queue cells live right after the wait slots.
+ static inline RegCell *clockRegCells(SimClock *clock) {
+     return (RegCell *) &clock->waits[clock->capacity];
+ }
+
+ // Initialize the registration queue (oss, before any worker starts).
+ static inline void clockRegInit(SimClock *clock) {
+     RegCell *cells = clockRegCells(clock);
+     clock->regMask = clockRegQueueSize(clock->capacity) - 1;
+     clock->regHead = 0;
+     clock->regTail = 0;
+     seqQueueInit(cells, sizeof(RegCell), clock->regMask);
+ }
+
+ // Announce an event (a new deadline or a finished job) for the given slot.
+ // Returns 0 if the queue is full.
+ static inline int clockRegPush(SimClock *clock, int slot, int event) {
+     unsigned long long pos;
+     RegCell *cell = seqQueueClaim(&clock->regHead, clockRegCells(clock), sizeof(RegCell), clock->regMask, &pos);
+     if (cell == NULL) {
+         return 0;
+     }
+     cell->slot = slot;
+     cell->event = event;
+     seqQueuePublish(cell, pos);
+     return 1;
+ }
+
+ // Called by a worker right after clockRegPush: if oss is blocked waiting for workers,
+ // ring its doorbell so it drains the queue. Costs no system call while oss is running.
+ static inline void clockRegNotify(SimClock *clock) {
+     __atomic_thread_fence(__ATOMIC_SEQ_CST);
+     if (__atomic_load_n(&clock->ossSleeping, __ATOMIC_RELAXED)) {
+         unsigned long long one = 1;
+         if (write(clock->doorbellFd, &one, sizeof(one)) < 0) {
+             // Nothing to do: oss also wakes up on its own after a short timeout.
+         }
+     }
+ }
+
+ // Take the next announced event (oss only). Returns 0 if the queue is empty.
+ static inline int clockRegPop(SimClock *clock, int *slot, int *event) {
+     RegCell *cell = seqQueuePeek(clockRegCells(clock), sizeof(RegCell), clock->regMask, clock->regTail);
+     if (cell == NULL) {
+         return 0;
+     }
+     *slot = cell->slot;
+     *event = cell->event;
+     seqQueueRelease(cell, clock->regTail, clock->regMask);
+     clock->regTail++;
+     return 1;
+ }
+
+ // Read the current simulated time in nanoseconds as one consistent snapshot.
+ static inline unsigned long long clockNow(const SimClock *clock) {
+     return __atomic_load_n(&clock->nano, __ATOMIC_ACQUIRE);
+ }
+
+ // Split a nanosecond time into its seconds and nanoseconds parts.
+ static inline void clockSplit(unsigned long long nano, int *sec, int *ns) {
+     *sec = (int) (nano / ONE_BILLION);
+     *ns = (int) (nano % ONE_BILLION);
+ }
+
+ // Read the current simulated time as a seconds/nanoseconds pair taken from one snapshot.
+ static inline void clockRead(const SimClock *clock, int *sec, int *ns) {
+     clockSplit(clockNow(clock), sec, ns);
+ }
+
+ // Set the simulated time. Only oss writes the clock, so a plain atomic store is enough;
+ // on 64-bit targets this compiles to a single move instruction.
+ static inline void clockSet(SimClock *clock, unsigned long long nano) {
+     __atomic_store_n(&clock->nano, nano, __ATOMIC_RELEASE);
+ }
+
+ // Sleep until *word no longer holds expected, a wake is issued, or the real-time
+ // timeout expires. Spurious returns are harmless: callers always recheck the clock.
+ static inline void futexWait(unsigned int *word, unsigned int expected, const struct timespec *timeout) {
+     syscall(SYS_futex, word, FUTEX_WAIT, expected, timeout, NULL, 0);
+ }
+
+ // Wake every process sleeping on the given futex word.
+ static inline void futexWake(unsigned int *word) {
+     syscall(SYS_futex, word, FUTEX_WAKE, __INT_MAX__, NULL, NULL, 0);
+ }
+
+ // Publish the simulated time at which the worker owning this slot wants to be woken.
+ // Sequentially consistent so it is ordered against the clock read the worker does next
+ // (pairs with the fence oss issues between updating the clock and scanning deadlines).
+ static inline void waitSlotArm(WaitSlot *slot, unsigned long long deadline) {
+     __atomic_store_n(&slot->deadline, deadline, __ATOMIC_SEQ_CST);
+ }
+
+ // Called by oss after the clock moved to now: wake the slot's worker if its deadline passed.
+ // Returns 1 if a wakeup was issued.
+ static inline int waitSlotExpire(WaitSlot *slot, unsigned long long now) {
+     unsigned long long deadline = __atomic_load_n(&slot->deadline, __ATOMIC_SEQ_CST);
+     if (deadline > now) {
+         return 0;
+     }
+     // Only clear the deadline we saw; if the worker re-armed meanwhile, leave the new one.
+     if (!__atomic_compare_exchange_n(&slot->deadline, &deadline, NO_DEADLINE, 0,
+                                      __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+         return 0;
+     }
+     __atomic_add_fetch(&slot->wakeWord, 1, __ATOMIC_SEQ_CST);
+     futexWake(&slot->wakeWord);
+     return 1;
+ }
+
+ // Hand a job to the pool worker owning this slot (oss only).
+ static inline void waitSlotPostJob(WaitSlot *slot, int sec, int nano) {
+     slot->jobSec = sec;
+     slot->jobNano = nano;
+     __atomic_add_fetch(&slot->jobWord, 1, __ATOMIC_RELEASE);
+     futexWake(&slot->jobWord);
+ }
+
+ // Create an anonymous shared memory object of the given size and map it read-write.
+ // With inherit set the descriptor survives exec, so launched workers can map the same
+ // memory; otherwise it is close-on-exec. Returns NULL on failure (errno set).
+ static inline void *sharedCreate(const char *name, size_t size, int inherit, int *fd) {
+     *fd = (int) syscall(SYS_memfd_create, name, inherit ? 0 : MFD_CLOEXEC);
+     if (*fd == -1) {
+         return NULL;
+     }
+     if (ftruncate(*fd, size) == -1) {
+         close(*fd);
+         return NULL;
+     }
+     void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+     if (map == MAP_FAILED) {
+         close(*fd);
+         return NULL;
+     }
+     return map;
+ }
+ 
+ // Map the whole shared memory object open on fd (read-only if asked) and store its size.
+ // Returns NULL on failure (errno set).
+ static inline void *sharedAttach(int fd, int readOnly, size_t *size) {
+     struct stat st;
+     if (fstat(fd, &st) == -1) {
+         return NULL;
+     }
+     *size = st.st_size;
+     void *map = mmap(NULL, *size, readOnly ? PROT_READ : (PROT_READ | PROT_WRITE), MAP_SHARED, fd, 0);
+     return (map == MAP_FAILED) ? NULL : map;
+ }
+ 
+ // Descriptor number stored in the given environment variable, or -1 if it is not set.
+ static inline int sharedFdFromEnv(const char *env) {
+     const char *value = getenv(env);
+     return value ? atoi(value) : -1;
+ }
+ 
+ // Store a descriptor number in the given environment variable for child processes.
+ static inline void sharedFdToEnv(const char *env, int fd) {
+     char value[16];
+     snprintf(value, sizeof(value), "%d", fd);
+     setenv(env, value, 1);
+ }
+ 
+ #endif
@@ -0,0 +1,172 @@
+/*
+ * trace.h
+ * Author: aqrabwi, 13/02/2025 (modified)
+ * Description: Binary event trace shared by oss, worker and tracedump.
+ *              oss creates a fixed-size file and every process maps it; each event claims
+ *              the next fixed-width record with one atomic add and fills it in place, so
+ *              tracing costs no system call. tracedump renders a trace as the familiar text
+ *              output or as CSV.
+ *
+ * File layout (all integers little-endian, host order):
+ *   TraceHeader (64 bytes) followed by `capacity` TraceRecords (48 bytes each).
+ *   A record whose type is 0 was claimed but never completed (or not claimed at all).
+ */
+
+ #ifndef TRACE_H
+ #define TRACE_H
+
+ #include <stdint.h>
+ #include <string.h>
+ #include <errno.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include "simclock.h"
+
+ // Identifies a trace file and its format version.
+ #define TRACE_MAGIC "OSSTRACE"
+ #define TRACE_VERSION 1
+
+ // Environment variable through which oss tells workers where the trace file is.
+ #define TRACE_ENV "OSS_TRACE"
+
+ // Event types.
+ #define EV_LAUNCH 1      // oss launched a worker. args: run seconds, run nanoseconds, launch ns,
+                          // launch backend (index into launchBackendNames).
+                          // The record's wall time is taken when the launch returned.
+ #define EV_START 2       // Worker started. args: target sec, target ns, parent PID.
+ #define EV_STATUS 3      // Worker saw a new second. args: target sec, target ns, parent PID, seconds passed.
+ #define EV_TERMINATE 4   // Worker reached its target. args: target sec, target ns, parent PID.
+ #define EV_REAP 5        // oss noticed the worker terminated.
+ #define EV_WAKE 6        // oss woke the worker because the clock reached its deadline.
+                          // args: deadline seconds, deadline nanoseconds.
+
+ // Command-line names of oss's launch backends (-b), indexed by oss's LaunchBackend.
+ static const char *const launchBackendNames[] = {"fork", "vfork", "spawn", "pool", "thread", "coro"};
+
+ // File header.
+ typedef struct {
+     char magic[8];             // TRACE_MAGIC, not NUL-terminated.
+     uint32_t version;          // TRACE_VERSION.
+     uint32_t recordSize;       // sizeof(TraceRecord).
+     uint64_t capacity;         // Number of records the file holds.
+     uint64_t claimed;          // Records claimed so far (atomic); may exceed capacity.
+     uint8_t reserved[32];
+ } TraceHeader;
+
+ // One event.
+ typedef struct {
+     uint32_t type;             // EV_* (written last; 0 means incomplete).
+     int32_t pid;               // Worker PID.
+     int32_t slot;              // Process table slot (-1 if none).
+     uint32_t simSec;           // Simulated time of the event.
+     uint32_t simNano;
+     uint32_t args[4];          // Event-specific values, see the EV_* definitions.
+     uint32_t reserved;
+     uint64_t wallNs;           // CLOCK_MONOTONIC time of the event.
+ } TraceRecord;
+
+ // A mapped trace file.
+ typedef struct {
+     TraceHeader *header;
+     TraceRecord *records;
+     size_t mappedBytes;
+ } TraceFile;
+
+ // Size of a trace file holding the given number of records.
+ static inline size_t traceFileSize(uint64_t capacity) {
+     return sizeof(TraceHeader) + capacity * sizeof(TraceRecord);
+ }
+
+ // Ways of opening a trace file.
+ #define TRACE_CREATE 0   // Create (or replace) the file with room for `capacity` records (oss).
+ #define TRACE_ATTACH 1   // Map an existing trace for appending events (worker).
+ #define TRACE_READ 2     // Map an existing trace read-only (tracedump).
+ 
+ // Map a trace file in the given mode (capacity is only used by TRACE_CREATE).
+ // Returns 0 on success, -1 with errno set on failure.
+ static inline int traceOpen(TraceFile *trace, const char *path, int mode, uint64_t capacity) {
+     int flags = (mode == TRACE_CREATE) ? (O_RDWR | O_CREAT | O_TRUNC) : (mode == TRACE_READ) ? O_RDONLY : O_RDWR;
+     int fd = open(path, flags, 0644);
+     if (fd == -1) {
+         return -1;
+     }
+     size_t size;
+     if (mode == TRACE_CREATE) {
+         size = traceFileSize(capacity);
+         if (ftruncate(fd, size) == -1) {
+             close(fd);
+             return -1;
+         }
+     } else {
+         struct stat st;
+         if (fstat(fd, &st) == -1 || (size_t) st.st_size < sizeof(TraceHeader)) {
+             close(fd);
+             errno = EINVAL;
+             return -1;
+         }
+         size = st.st_size;
+     }
+     void *map = mmap(NULL, size, (mode == TRACE_READ) ? PROT_READ : (PROT_READ | PROT_WRITE), MAP_SHARED, fd, 0);
+     close(fd);
+     if (map == MAP_FAILED) {
+         return -1;
+     }
+     trace->header = (TraceHeader *) map;
+     trace->records = (TraceRecord *) ((char *) map + sizeof(TraceHeader));
+     trace->mappedBytes = size;
+     if (mode == TRACE_CREATE) {
+         memcpy(trace->header->magic, TRACE_MAGIC, 8);
+         trace->header->version = TRACE_VERSION;
+         trace->header->recordSize = sizeof(TraceRecord);
+         trace->header->capacity = capacity;
+         trace->header->claimed = 0;
+     } else if (memcmp(trace->header->magic, TRACE_MAGIC, 8) != 0
+                || trace->header->recordSize != sizeof(TraceRecord)
+                || traceFileSize(trace->header->capacity) > size) {
+         munmap(map, size);
+         errno = EINVAL;
+         return -1;
+     }
+     return 0;
+ }
+
+ // Unmap a trace file.
+ static inline void traceClose(TraceFile *trace) {
+     munmap(trace->header, trace->mappedBytes);
+     trace->header = NULL;
+ }
+
+ // Number of records actually stored (claims past the capacity were dropped).
+ static inline uint64_t traceCount(const TraceFile *trace) {
+     uint64_t claimed = __atomic_load_n(&trace->header->claimed, __ATOMIC_ACQUIRE);
+     return claimed < trace->header->capacity ? claimed : trace->header->capacity;
+ }
+
+ // Append one event. Events beyond the file's capacity are counted but dropped.
+ static inline void traceEmit(TraceFile *trace, uint32_t type, pid_t pid, int slot,
+                              unsigned long long simNs, uint32_t arg0, uint32_t arg1,
+                              uint32_t arg2, uint32_t arg3) {
+     uint64_t index = __atomic_fetch_add(&trace->header->claimed, 1, __ATOMIC_RELAXED);
+     if (index >= trace->header->capacity) {
+         return;
+     }
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     TraceRecord *rec = &trace->records[index];
+     rec->pid = pid;
+     rec->slot = slot;
+     rec->simSec = (uint32_t) (simNs / ONE_BILLION);
+     rec->simNano = (uint32_t) (simNs % ONE_BILLION);
+     rec->args[0] = arg0;
+     rec->args[1] = arg1;
+     rec->args[2] = arg2;
+     rec->args[3] = arg3;
+     rec->reserved = 0;
+     rec->wallNs = (uint64_t) ts.tv_sec * ONE_BILLION + ts.tv_nsec;
+     // Publish the record by writing its type last.
+     __atomic_store_n(&rec->type, type, __ATOMIC_RELEASE);
+ }
+
+ #endif
@@ -0,0 +1,119 @@
+/*
+ * tracedump.c
+ * Author: aqrabwi, 13/02/2025 (modified)
+ * Description: Decodes a binary event trace written by oss -T. By default each event is
+ *              rendered as the line oss or the worker prints for it (wakeups, which print
+ *              nothing, are left out); with -c the trace is written as CSV (one row per
+ *              event, including the wall-clock timestamp).
+ *
+ * Usage: tracedump [-h] [-c] traceFile
+ */
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <unistd.h>
+ #include <string.h>
+ #include <errno.h>
+ #include <stdbool.h>
+ #include <getopt.h>
+ #include "trace.h"
+
+ // Size of the stdout buffer: decoded traces are large, so write in big chunks.
+ #define OUTPUT_BUFFER_BYTES (1 << 20)
+
+ // CSV names of the event types, indexed by EV_* value.
+ const char *eventNames[] = {"incomplete", "launch", "start", "status", "terminate", "reap", "wake"};
+
+ // Function to print one event the way oss or the worker prints it.
+ void printText(const TraceRecord *rec) {
+     switch (rec->type) {
+         case EV_LAUNCH:
+             printf("Launched worker PID %d at simulated time %u s, %u ns. (Worker will run for %u s and %u ns) [%s: %u us]\n",
+                    rec->pid, rec->simSec, rec->simNano, rec->args[0], rec->args[1],
+                    rec->args[3] < sizeof(launchBackendNames) / sizeof(launchBackendNames[0]) ?
+                    launchBackendNames[rec->args[3]] : "?", rec->args[2] / 1000);
+             break;
+         case EV_START:
+             printf("WORKER PID: %d PPID: %u | SysClock: %u s, %u ns | Target Termination: %u s, %u ns -- Just Starting\n",
+                    rec->pid, rec->args[2], rec->simSec, rec->simNano, rec->args[0], rec->args[1]);
+             break;
+         case EV_STATUS:
+             printf("WORKER PID: %d PPID: %u | SysClock: %u s, %u ns | Target Termination: %u s, %u ns -- %u seconds have passed since starting\n",
+                    rec->pid, rec->args[2], rec->simSec, rec->simNano, rec->args[0], rec->args[1], rec->args[3]);
+             break;
+         case EV_TERMINATE:
+             printf("WORKER PID: %d PPID: %u | SysClock: %u s, %u ns | Target Termination: %u s, %u ns -- Terminating\n",
+                    rec->pid, rec->args[2], rec->simSec, rec->simNano, rec->args[0], rec->args[1]);
+             break;
+         case EV_REAP:
+             printf("Child PID %d terminated.\n", rec->pid);
+             break;
+     }
+ }
+
+ // Function to print one event as a CSV row.
+ void printCsv(const TraceRecord *rec) {
+     printf("%s,%d,%d,%u,%u,%llu,%u,%u,%u,%u\n", eventNames[rec->type], rec->pid, rec->slot,
+            rec->simSec, rec->simNano, (unsigned long long) rec->wallNs,
+            rec->args[0], rec->args[1], rec->args[2], rec->args[3]);
+ }
+
+ int main(int argc, char *argv[]) {
+     int opt;
+     bool csv = false;
+     // Parse command-line options using getopt.
+     // Options:
+     //  -h: help
+     //  -c: write CSV instead of text
+     while ((opt = getopt(argc, argv, "hc")) != -1) {
+         switch (opt) {
+             case 'h':
+                 printf("Usage: %s [-c] traceFile\n", argv[0]);
+                 exit(0);
+             case 'c':
+                 csv = true;
+                 break;
+             default:
+                 fprintf(stderr, "Unknown option: %c\n", opt);
+                 exit(1);
+         }
+     }
+     if (optind >= argc) {
+         fprintf(stderr, "Usage: %s [-c] traceFile\n", argv[0]);
+         exit(1);
+     }
+
+     // Map the trace read-only.
+     TraceFile trace;
+     if (traceOpen(&trace, argv[optind], TRACE_READ, 0) == -1) {
+         fprintf(stderr, "tracedump: %s: %s\n", argv[optind], strerror(errno));
+         exit(1);
+     }
+     if (trace.header->version != TRACE_VERSION) {
+         fprintf(stderr, "tracedump: %s: unsupported trace version %u\n", argv[optind], trace.header->version);
+         exit(1);
+     }
+
+     static char outputBuffer[OUTPUT_BUFFER_BYTES];
+     setvbuf(stdout, outputBuffer, _IOFBF, sizeof(outputBuffer));
+     if (csv) {
+         printf("event,pid,slot,sim_sec,sim_ns,wall_ns,arg0,arg1,arg2,arg3\n");
+     }
+
+     // Records are decoded in the order they were claimed; incomplete ones are skipped.
+     uint64_t count = traceCount(&trace);
+     for (uint64_t i = 0; i < count; i++) {
+         const TraceRecord *rec = &trace.records[i];
+         if (rec->type == 0 || rec->type > EV_WAKE) {
+             continue;
+         }
+         if (csv) {
+             printCsv(rec);
+         } else {
+             printText(rec);
+         }
+     }
+
+     traceClose(&trace);
+     return 0;
+ }
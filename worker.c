@@ -3,29 +3,47 @@
  * Author: aqrabwi, 13/02/2025 (modified)
  * Description: Worker process that attaches to the shared simulated clock,
  *              computes a target termination time based on command-line arguments,
- *              and busy-loops (without sleep) until the simulated clock passes that target.
+ *              and waits until the simulated clock passes that target. When oss passes a
+ *              wait slot number the worker sleeps on that slot's futex between the instants
+ *              it cares about (each new simulated second and its target); without one it
+ *              busy-loops on the clock as before.
+ *              With -p the worker is a pre-started pool member: it stays attached and runs
+ *              one job after another as oss posts them to its slot's mailbox.
  *
- * Usage: worker <secondsToStay> <nanoToStay>
+ * Usage: worker <secondsToStay> <nanoToStay> [slot]
+ *        worker -p <slot>
  */
 
  #include <stdio.h>      
  #include <stdlib.h>     
+ #include <string.h>     
  #include <unistd.h>     
- #include <sys/shm.h>    
- #include <sys/ipc.h>    
+ #include <sys/mman.h>   
  #include <signal.h>     
+ #include <sched.h>      
  #include <stdbool.h>    
+ #include <stdarg.h>     
+ #include "simclock.h"
+ #include "logring.h"
+ #include "trace.h"
+ #include "workerjob.h"
  
- // Define the shared memory key for the simulated clock.
- #define SHMKEY 9876
- // Define the value representing one billion for nanosecond calculations.
- #define ONE_BILLION 1000000000
- 
- // Global variable to hold the shared memory ID.
- int shmid;
+ // Size of the mapped clock segment.
+ size_t clockBytes = 0;
  // Pointer to the shared memory segment representing the simulated clock.
- // shmClock[0] holds seconds, and shmClock[1] holds nanoseconds.
- int *shmClock;
+ SimClock *shmClock;
+ 
+ // Size of oss's mapped log ring.
+ size_t logBytes = 0;
+ 
+ // oss's binary trace, when oss was started with -T.
+ TraceFile trace;
+ 
+ // Where this worker's jobs run and report: the clock, the wait slot assigned by oss
+ // (-1 and NULL when polling the clock instead of sleeping), oss's log ring (NULL when
+ // there is none and the worker prints directly) and trace, and oss's PID (a different
+ // parent means oss is gone).
+ WorkerContext ctx = {.slot = -1};
  
  /*
   * cleanupWorker - Signal handler for cleaning up shared memory and exiting.
@@ -36,93 +54,136 @@
   */
  void cleanupWorker(int signum) {
      // Check if the shared memory pointer is valid.
-     if (shmClock != (void *) -1) {
-         // Detach the shared memory segment from this process's address space.
-         shmdt(shmClock);
+     if (shmClock != NULL) {
+         // Unmap the shared memory segment from this process's address space.
+         munmap(shmClock, clockBytes);
      }
      // Exit the process with a status of 1 (indicating abnormal termination).
      exit(1);
  }
  
- int main(int argc, char *argv[]) {
-     // Verify that the required command-line arguments are provided.
-     // The program expects two arguments: secondsToStay and nanoToStay.
-     if (argc < 3) {
-         fprintf(stderr, "Usage: %s <secondsToStay> <nanoToStay>\n", argv[0]);
+ /*
+  * runJob - Stay alive for the given simulated duration (see workerRunJob).
+  * @secondsToStay: Simulated seconds to run for.
+  * @nanoToStay: Simulated nanoseconds to run for.
+  *
+  * Exits the process if oss goes away while the job runs.
+  */
+ void runJob(int secondsToStay, int nanoToStay) {
+     if (workerRunJob(&ctx, secondsToStay, nanoToStay) == -1) {
+         fprintf(stderr, "worker: oss exited, terminating\n");
          exit(1);
      }
+ }
  
-     // Convert command-line arguments from strings to integers.
-     int secondsToStay = atoi(argv[1]);
-     int nanoToStay = atoi(argv[2]);
+ /*
+  * runPool - Main loop of a pre-started pool worker.
+  *
+  * Waits for oss to post a job to this slot's mailbox, runs it, and reports that it
+  * finished through the registration queue, until oss posts JOB_EXIT.
+  */
+ void runPool() {
+     WaitSlot *waitSlot = ctx.waitSlot;
+     unsigned int handled = 0;
+     while (true) {
+         // Sleep until oss posts a job (the mailbox word moves past the last job handled).
+         unsigned int posted;
+         while ((posted = __atomic_load_n(&waitSlot->jobWord, __ATOMIC_ACQUIRE)) == handled) {
+             struct timespec timeout = {1, 0};
+             futexWait(&waitSlot->jobWord, handled, &timeout);
+             if (getppid() != ctx.parent) {
+                 fprintf(stderr, "worker: oss exited, terminating\n");
+                 exit(1);
+             }
+         }
+         handled = posted;
+         if (waitSlot->jobSec == JOB_EXIT) {
+             return;
+         }
+         runJob(waitSlot->jobSec, waitSlot->jobNano);
+         workerJobDone(&ctx);
+     }
+ }
+ 
+ int main(int argc, char *argv[]) {
+     // A pool member is started as "worker -p <slot>" and gets its jobs from oss later.
+     bool poolMode = (argc == 3 && strcmp(argv[1], "-p") == 0);
+     int secondsToStay = 0, nanoToStay = 0;
+     if (poolMode) {
+         ctx.slot = atoi(argv[2]);
+     } else {
+         // Verify that the required command-line arguments are provided.
+         // The program expects two arguments: secondsToStay and nanoToStay.
+         if (argc < 3) {
+             fprintf(stderr, "Usage: %s <secondsToStay> <nanoToStay> [slot]\n       %s -p <slot>\n", argv[0], argv[0]);
+             exit(1);
+         }
+ 
+         // Convert command-line arguments from strings to integers.
+         secondsToStay = atoi(argv[1]);
+         nanoToStay = atoi(argv[2]);
+         // Optional wait slot assigned by oss; -1 means poll the clock instead of sleeping.
+         ctx.slot = (argc > 3) ? atoi(argv[3]) : -1;
+     }
  
      // Set up a signal handler for SIGINT (e.g., when the user presses Ctrl-C)
      // to ensure proper cleanup of shared memory.
      signal(SIGINT, cleanupWorker);
  
-     // Attach to the existing shared memory segment that holds the simulated clock.
-     // The segment is expected to be created by the oss process.
-     shmid = shmget(SHMKEY, 2 * sizeof(int), 0666);
-     if (shmid == -1) {
-         perror("worker: shmget");
+     // Map the shared memory segment that holds the simulated clock. oss created it and
+     // the worker inherited its descriptor, whose number oss put in the environment.
+     int clockFd = sharedFdFromEnv(CLOCK_FD_ENV);
+     if (clockFd == -1) {
+         fprintf(stderr, "worker: %s not set (the worker is started by oss)\n", CLOCK_FD_ENV);
          exit(1);
      }
- 
-     // Attach the shared memory segment to our process's address space.
-     shmClock = (int *) shmat(shmid, NULL, 0);
-     if (shmClock == (int *) -1) {
-         perror("worker: shmat");
+     shmClock = (SimClock *) sharedAttach(clockFd, 0, &clockBytes);
+     if (shmClock == NULL || clockBytes < sizeof(SimClock)) {
+         perror("worker: clock segment");
          exit(1);
      }
  
-     // Capture the starting simulated time from the shared memory.
-     int startSec = shmClock[0];
-     int startNano = shmClock[1];
- 
-     // Calculate the target termination time by adding the desired duration
-     // (provided by the command-line arguments) to the starting simulated time.
-     int targetSec = startSec + secondsToStay;
-     int targetNano = startNano + nanoToStay;
-     // Normalize the target time if nanoseconds exceed one billion.
-     if (targetNano >= ONE_BILLION) {
-         targetSec += targetNano / ONE_BILLION;
-         targetNano %= ONE_BILLION;
+     // Send output through oss's log ring when there is one.
+     int logFd = sharedFdFromEnv(LOG_FD_ENV);
+     if (logFd != -1) {
+         ctx.logRing = (LogRing *) sharedAttach(logFd, 0, &logBytes);
      }
  
-     // Output initial status information including process IDs,
-     // current simulated clock, and target termination time.
-     printf("WORKER PID: %d PPID: %d | SysClock: %d s, %d ns | Target Termination: %d s, %d ns -- Just Starting\n",
-            getpid(), getppid(), startSec, startNano, targetSec, targetNano);
- 
-     // Variable to track the last second printed for periodic updates.
-     int lastPrintedSec = startSec;
- 
-     // Enter a busy-loop: the worker will continuously check the simulated clock
-     // until the current time meets or exceeds the target termination time.
-     while (true) {
-         // Check if the simulated clock has reached or passed the target termination time.
-         // The condition checks if the seconds part is greater than the target seconds,
-         // or if equal, whether the nanoseconds part is greater than or equal to the target nanoseconds.
-         if ((shmClock[0] > targetSec) ||
-             (shmClock[0] == targetSec && shmClock[1] >= targetNano)) {
-             // If the target is reached, output a termination message with current time.
-             printf("WORKER PID: %d PPID: %d | SysClock: %d s, %d ns | Target Termination: %d s, %d ns -- Terminating\n",
-                    getpid(), getppid(), shmClock[0], shmClock[1], targetSec, targetNano);
-             break;
+     // Append to oss's binary trace if it asked for one.
+     const char *tracePath = getenv(TRACE_ENV);
+     if (tracePath != NULL) {
+         if (traceOpen(&trace, tracePath, TRACE_ATTACH, 0) == -1) {
+             perror("worker: trace file");
+         } else {
+             ctx.trace = &trace;
          }
-         // Every time the simulated seconds change, print a status update.
-         if (shmClock[0] != lastPrintedSec) {
-             printf("WORKER PID: %d PPID: %d | SysClock: %d s, %d ns | Target Termination: %d s, %d ns -- %d seconds have passed since starting\n",
-                    getpid(), getppid(), shmClock[0], shmClock[1], targetSec, targetNano, shmClock[0] - startSec);
-             // Update the last printed second to avoid duplicate messages.
-             lastPrintedSec = shmClock[0];
+     }
+ 
+     // Validate the wait slot against the table size oss published in the segment.
+     if (ctx.slot >= 0) {
+         if (ctx.slot >= shmClock->capacity) {
+             fprintf(stderr, "worker: slot %d out of range (capacity %d)\n", ctx.slot, shmClock->capacity);
+             exit(1);
          }
-         // The busy-loop does not call sleep() or usleep() because the simulation
-         // depends entirely on the increments of the shared simulated clock.
+         ctx.waitSlot = &shmClock->waits[ctx.slot];
      }
+     ctx.clock = shmClock;
+     ctx.pid = getpid();
+     ctx.ppid = getppid();
+     ctx.parent = ctx.ppid;
  
-     // Once the loop exits (i.e., the worker's time has expired), detach the shared memory.
-     shmdt(shmClock);
+     // Run the single job given on the command line, or serve jobs as a pool member.
+     if (poolMode) {
+         runPool();
+     } else {
+         runJob(secondsToStay, nanoToStay);
+     }
+ 
+     // Once the worker's time has expired (or the pool was shut down), detach the shared memory.
+     if (ctx.logRing != NULL) {
+         munmap(ctx.logRing, logBytes);
+     }
+     munmap(shmClock, clockBytes);
  
      // Return 0 to indicate normal termination.
      return 0;
@@ -0,0 +1,262 @@
+/*
+ * workerjob.h
+ * Author: aqrabwi, 13/02/2025 (modified)
+ * Description: The worker's job logic, shared by the worker process (worker.c) and oss's
+ *              in-process thread backend (oss -b thread). A job computes its target from
+ *              the simulated clock, prints a status line each simulated second and returns
+ *              once the clock reaches the target, sleeping on its wait slot's futex in
+ *              between. Everything a job needs is in a WorkerContext, so the same code runs
+ *              in its own process or as one of many threads inside oss.
+ *              The same logic is also available as a stackless coroutine (oss -b coro): the
+ *              job's state lives in a small struct, and each resume runs until the job
+ *              needs a later simulated time, which it returns instead of sleeping. oss's
+ *              scheduler resumes it only once the clock reaches that time.
+ */
+
+ #ifndef WORKERJOB_H
+ #define WORKERJOB_H
+
+ #include <stdio.h>
+ #include <stdarg.h>
+ #include <sched.h>
+ #include "simclock.h"
+ #include "logring.h"
+ #include "trace.h"
+
+ // Where a job runs and reports.
+ typedef struct {
+     SimClock *clock;       // The shared simulated clock.
+     WaitSlot *waitSlot;    // Wait slot to sleep on (NULL: busy-loop on the clock).
+     int slot;              // Number of that slot (-1 without one).
+     pid_t pid;             // Worker PID printed and traced.
+     pid_t ppid;            // Parent PID printed and traced (oss).
+     pid_t parent;          // Worker processes: oss's PID, to notice oss dying (0 for threads).
+     LogRing *logRing;      // oss's log ring (NULL: print to stdout).
+     TraceFile *trace;      // oss's binary trace (NULL when not tracing).
+ } WorkerContext;
+
+ /*
+  * workerLog - printf-style output through oss's log ring (or stdout without one).
+  * @ctx: The job's context.
+  * @format: printf format of one complete line.
+  */
+ static inline void workerLog(const WorkerContext *ctx, const char *format, ...) __attribute__((format(printf, 2, 3)));
+ static inline void workerLog(const WorkerContext *ctx, const char *format, ...) {
+     va_list args;
+     va_start(args, format);
+     if (ctx->logRing != NULL) {
+         logRingVPrintf(ctx->logRing, format, args);
+     } else {
+         vprintf(format, args);
+     }
+     va_end(args);
+ }
+
+ // The three reports a job makes, shared by workerRunJob and its coroutine version so both
+ // print and trace exactly the same thing.
+
+ // Report that the job started at the given simulated time and when it will terminate.
+ static inline void workerReportStart(const WorkerContext *ctx, int startSec, int startNano,
+                                      int targetSec, int targetNano) {
+     workerLog(ctx, "WORKER PID: %d PPID: %d | SysClock: %d s, %d ns | Target Termination: %d s, %d ns -- Just Starting\n",
+            ctx->pid, ctx->ppid, startSec, startNano, targetSec, targetNano);
+     if (ctx->trace != NULL) {
+         traceEmit(ctx->trace, EV_START, ctx->pid, ctx->slot, (unsigned long long) startSec * ONE_BILLION + startNano,
+                   targetSec, targetNano, ctx->ppid, 0);
+     }
+ }
+
+ // Report a new simulated second, secondsPassed seconds after the job started.
+ static inline void workerReportStatus(const WorkerContext *ctx, int nowSec, int nowNano,
+                                       int targetSec, int targetNano, int secondsPassed) {
+     workerLog(ctx, "WORKER PID: %d PPID: %d | SysClock: %d s, %d ns | Target Termination: %d s, %d ns -- %d seconds have passed since starting\n",
+            ctx->pid, ctx->ppid, nowSec, nowNano, targetSec, targetNano, secondsPassed);
+     if (ctx->trace != NULL) {
+         traceEmit(ctx->trace, EV_STATUS, ctx->pid, ctx->slot, (unsigned long long) nowSec * ONE_BILLION + nowNano,
+                   targetSec, targetNano, ctx->ppid, secondsPassed);
+     }
+ }
+
+ // Report that the job reached its target termination time.
+ static inline void workerReportTerminate(const WorkerContext *ctx, int nowSec, int nowNano,
+                                          int targetSec, int targetNano) {
+     workerLog(ctx, "WORKER PID: %d PPID: %d | SysClock: %d s, %d ns | Target Termination: %d s, %d ns -- Terminating\n",
+            ctx->pid, ctx->ppid, nowSec, nowNano, targetSec, targetNano);
+     if (ctx->trace != NULL) {
+         traceEmit(ctx->trace, EV_TERMINATE, ctx->pid, ctx->slot, (unsigned long long) nowSec * ONE_BILLION + nowNano,
+                   targetSec, targetNano, ctx->ppid, 0);
+     }
+ }
+
+ /*
+  * workerRunJob - Stay alive for the given simulated duration.
+  * @ctx: The job's context.
+  * @secondsToStay: Simulated seconds to run for.
+  * @nanoToStay: Simulated nanoseconds to run for.
+  *
+  * Computes the target termination time from the current simulated clock, prints a
+  * status line each simulated second and returns 0 once the target has been reached,
+  * or -1 if oss went away first (worker processes only).
+  */
+ static inline int workerRunJob(const WorkerContext *ctx, int secondsToStay, int nanoToStay) {
+     // Capture the starting simulated time from the shared memory.
+     int startSec, startNano;
+     clockRead(ctx->clock, &startSec, &startNano);
+
+     // Calculate the target termination time by adding the desired duration
+     // (provided by the command-line arguments) to the starting simulated time.
+     int targetSec = startSec + secondsToStay;
+     int targetNano = startNano + nanoToStay;
+     // Normalize the target time if nanoseconds exceed one billion.
+     if (targetNano >= ONE_BILLION) {
+         targetSec += targetNano / ONE_BILLION;
+         targetNano %= ONE_BILLION;
+     }
+
+     // Output initial status information including process IDs,
+     // current simulated clock, and target termination time.
+     workerReportStart(ctx, startSec, startNano, targetSec, targetNano);
+
+     // Variable to track the last second printed for periodic updates.
+     int lastPrintedSec = startSec;
+     WaitSlot *waitSlot = ctx->waitSlot;
+
+     // Enter the wait loop: the worker checks the simulated clock until the current
+     // time meets or exceeds the target termination time.
+     while (1) {
+         // With a wait slot, remember the futex word before looking at the clock so a
+         // wakeup issued after this point is never missed.
+         unsigned int seenWake = waitSlot ? __atomic_load_n(&waitSlot->wakeWord, __ATOMIC_SEQ_CST) : 0;
+
+         // Take one consistent snapshot of the clock per iteration so the seconds and
+         // nanoseconds used below always belong to the same instant.
+         int nowSec, nowNano;
+         clockRead(ctx->clock, &nowSec, &nowNano);
+
+         // Check if the simulated clock has reached or passed the target termination time.
+         // The condition checks if the seconds part is greater than the target seconds,
+         // or if equal, whether the nanoseconds part is greater than or equal to the target nanoseconds.
+         if ((nowSec > targetSec) ||
+             (nowSec == targetSec && nowNano >= targetNano)) {
+             // If the target is reached, output a termination message with current time.
+             workerReportTerminate(ctx, nowSec, nowNano, targetSec, targetNano);
+             return 0;
+         }
+         // Every time the simulated seconds change, print a status update.
+         if (nowSec != lastPrintedSec) {
+             workerReportStatus(ctx, nowSec, nowNano, targetSec, targetNano, nowSec - startSec);
+             // Update the last printed second to avoid duplicate messages.
+             lastPrintedSec = nowSec;
+         }
+         // Without a wait slot the loop does not call sleep() or usleep() because the
+         // simulation depends entirely on the increments of the shared simulated clock.
+         if (waitSlot == NULL) {
+             continue;
+         }
+
+         // The next instant worth waking for is the start of the next simulated second
+         // (for the status line) or the target, whichever comes first.
+         unsigned long long target = (unsigned long long) targetSec * ONE_BILLION + targetNano;
+         unsigned long long nextSecond = (unsigned long long) (nowSec + 1) * ONE_BILLION;
+         unsigned long long deadline = (nextSecond < target) ? nextSecond : target;
+         waitSlotArm(waitSlot, deadline);
+         // Tell oss there is a new deadline to put in its heap. The queue is sized so it
+         // cannot really fill up, but if it does, give oss the CPU to drain it.
+         while (!clockRegPush(ctx->clock, ctx->slot, REG_DEADLINE)) {
+             sched_yield();
+         }
+         clockRegNotify(ctx->clock);
+         // Recheck after publishing: if oss moved the clock past the deadline before it
+         // could see it, handle that instant now instead of sleeping.
+         if (clockNow(ctx->clock) >= deadline) {
+             continue;
+         }
+         // Sleep until oss bumps the futex word. The real-time timeout only guards
+         // against oss dying without waking us; in that case we are reparented.
+         struct timespec timeout = {1, 0};
+         futexWait(&waitSlot->wakeWord, seenWake, &timeout);
+         if (ctx->parent != 0 && getppid() != ctx->parent) {
+             return -1;
+         }
+     }
+ }
+
+ // State of a job run as a stackless coroutine. Locals that must survive a suspension
+ // live here; pc is the resume point (0 = not started).
+ typedef struct {
+     int pc;
+     int secondsToStay;       // Run time, set before the first resume.
+     int nanoToStay;
+     int startSec;
+     int startNano;
+     int targetSec;
+     int targetNano;
+     int lastPrintedSec;
+ } WorkerCoroutine;
+
+ // Coroutine control flow in the style of protothreads: a switch on the resume point,
+ // with a case label placed after every suspension.
+ #define CORO_BEGIN(co) switch ((co)->pc) { case 0:
+ #define CORO_SUSPEND(co, value) do { (co)->pc = __LINE__; return (value); case __LINE__:; } while (0)
+ #define CORO_END(co) } (co)->pc = -1
+
+ /*
+  * workerCoroutineResume - Run a coroutine job until it needs a later simulated time.
+  * @co: The job's coroutine state.
+  * @ctx: The job's context (its wait slot is not used).
+  *
+  * Does what workerRunJob does between two sleeps and returns the simulated time to be
+  * resumed at, or NO_DEADLINE once the job has terminated. The caller only resumes the
+  * job once the clock has reached the returned time.
+  */
+ static inline unsigned long long workerCoroutineResume(WorkerCoroutine *co, const WorkerContext *ctx) {
+     int nowSec, nowNano;
+     CORO_BEGIN(co);
+     // Capture the starting simulated time and compute the target from it.
+     clockRead(ctx->clock, &co->startSec, &co->startNano);
+     co->targetSec = co->startSec + co->secondsToStay;
+     co->targetNano = co->startNano + co->nanoToStay;
+     if (co->targetNano >= ONE_BILLION) {
+         co->targetSec += co->targetNano / ONE_BILLION;
+         co->targetNano %= ONE_BILLION;
+     }
+     workerReportStart(ctx, co->startSec, co->startNano, co->targetSec, co->targetNano);
+     co->lastPrintedSec = co->startSec;
+
+     while (1) {
+         clockRead(ctx->clock, &nowSec, &nowNano);
+         // Terminate once the target has been reached.
+         if ((nowSec > co->targetSec) ||
+             (nowSec == co->targetSec && nowNano >= co->targetNano)) {
+             workerReportTerminate(ctx, nowSec, nowNano, co->targetSec, co->targetNano);
+             break;
+         }
+         // Every time the simulated seconds change, print a status update.
+         if (nowSec != co->lastPrintedSec) {
+             workerReportStatus(ctx, nowSec, nowNano, co->targetSec, co->targetNano, nowSec - co->startSec);
+             co->lastPrintedSec = nowSec;
+         }
+         // Suspend until the next simulated second or the target, whichever comes first.
+         {
+             unsigned long long target = (unsigned long long) co->targetSec * ONE_BILLION + co->targetNano;
+             unsigned long long nextSecond = (unsigned long long) (nowSec + 1) * ONE_BILLION;
+             CORO_SUSPEND(co, (nextSecond < target) ? nextSecond : target);
+         }
+     }
+     CORO_END(co);
+     return NO_DEADLINE;
+ }
+
+ // Report to oss that the job in the context's slot finished (pool members and threads).
+ // Once the report is queued, oss may hand the slot (and a thread's context) to a new job,
+ // so everything needed afterwards is copied out first.
+ static inline void workerJobDone(const WorkerContext *ctx) {
+     SimClock *clock = ctx->clock;
+     int slot = ctx->slot;
+     while (!clockRegPush(clock, slot, REG_DONE)) {
+         sched_yield();
+     }
+     clockRegNotify(clock);
+ }
+
+ #endif
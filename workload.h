@@ -0,0 +1,216 @@
+/*
+ * workload.h
+ * Author: aqrabwi, 13/02/2025 (modified)
+ * Description: Workload generators for oss: the distribution worker runtimes are drawn
+ *              from (-d) and the spacing of job arrivals (-a). Values are generated in
+ *              batches of WORKLOAD_BATCH: each batch first takes its random bits from the
+ *              counter-based stream in rng.h (independent iterations, so the compiler can
+ *              vectorize the loop), then maps them to runtimes in a second tight loop.
+ *              A launch just takes the next value of the current batch.
+ *
+ * Every job uses two values of the runtime stream, whatever the distribution, so the
+ * uniform distribution draws exactly what oss drew before generators existed.
+ */
+
+ #ifndef WORKLOAD_H
+ #define WORKLOAD_H
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <math.h>
+ #include "simclock.h"
+ #include "rng.h"
+
+ // Number of values generated at once.
+ #define WORKLOAD_BATCH 256
+
+ // Key mixed into the seed for the arrival stream, so arrivals and runtimes never share
+ // random bits (not even across runs with neighbouring seeds).
+ #define ARRIVAL_STREAM_KEY 0x6a09e667f3bcc909ULL
+
+ // Longest runtime a distribution may produce (heavy tails are cut off here).
+ #define WORKLOAD_MAX_SECONDS 1000000.0
+
+ // Runtime distributions, selected with -d.
+ typedef enum {
+     DIST_UNIFORM,    // 1..-t seconds plus a uniform nanosecond part (the default).
+     DIST_FIXED,      // fixed:S       every worker runs S seconds.
+     DIST_EXP,        // exp:M         exponential with mean M seconds.
+     DIST_PARETO,     // pareto:A:X    Pareto with shape A and minimum X seconds (heavy tail).
+     DIST_BIMODAL     // bimodal:P:S:L exponential with mean S with probability P, else mean L.
+ } DurationDist;
+
+ // Names accepted by -d, indexed by DurationDist, and how many parameters each takes.
+ static const char *durationDistNames[] = {"uniform", "fixed", "exp", "pareto", "bimodal"};
+ static const int durationDistParams[] = {0, 1, 1, 2, 3};
+
+ // Job arrival processes, selected with -a.
+ typedef enum {
+     ARRIVAL_FIXED,   // One arrival every -i milliseconds (the default).
+     ARRIVAL_POISSON  // Poisson arrivals: exponential gaps with mean -i milliseconds.
+ } ArrivalProcess;
+
+ static const char *arrivalNames[] = {"fixed", "poisson"};
+
+ // A runtime generator and its current batch.
+ typedef struct {
+     DurationDist dist;
+     double params[3];
+     int limitSec;                         // -t (uniform only).
+     Rng rng;
+     int sec[WORKLOAD_BATCH];
+     int nano[WORKLOAD_BATCH];
+     int next;                             // Next unused value of the batch.
+ } DurationGen;
+
+ // An arrival gap generator and its current batch.
+ typedef struct {
+     double meanNs;
+     Rng rng;
+     unsigned long long gap[WORKLOAD_BATCH];
+     int next;
+ } ArrivalGen;
+
+ /*
+  * durationParse - Parse a -d specification such as "exp:2.5".
+  * @gen: Generator to configure.
+  * @text: Distribution name, followed by its parameters separated by ':'.
+  *
+  * Returns 0 on success, or -1 for an unknown name, a wrong number of parameters or
+  * parameters out of range.
+  */
+ static inline int durationParse(DurationGen *gen, const char *text) {
+     char copy[128];
+     snprintf(copy, sizeof(copy), "%s", text);
+     char *save, *name = strtok_r(copy, ":", &save);
+     int count = 0;
+     for (char *tok = strtok_r(NULL, ":", &save); tok != NULL; tok = strtok_r(NULL, ":", &save)) {
+         if (count == 3) {
+             return -1;
+         }
+         gen->params[count++] = atof(tok);
+     }
+     for (int i = 0; i <= DIST_BIMODAL; i++) {
+         if (name != NULL && strcmp(name, durationDistNames[i]) == 0 && count == durationDistParams[i]) {
+             gen->dist = (DurationDist) i;
+             double *p = gen->params;
+             switch (gen->dist) {
+                 case DIST_FIXED:
+                 case DIST_EXP:
+                     return p[0] >= 0 ? 0 : -1;
+                 case DIST_PARETO:
+                     return (p[0] > 0 && p[1] > 0) ? 0 : -1;
+                 case DIST_BIMODAL:
+                     return (p[0] >= 0 && p[0] <= 1 && p[1] >= 0 && p[2] >= 0) ? 0 : -1;
+                 default:
+                     return 0;
+             }
+         }
+     }
+     return -1;
+ }
+
+ // Uniform double in [0, 1) from 64 random bits.
+ static inline double workloadUnit(uint64_t bits) {
+     return (bits >> 11) * (1.0 / 9007199254740992.0);
+ }
+
+ // Exponential value with the given mean from a uniform value in [0, 1).
+ static inline double workloadExp(double mean, double u) {
+     return -mean * log1p(-u);
+ }
+
+ // Function to generate the next batch of runtimes.
+ static inline void durationFill(DurationGen *gen) {
+     uint64_t bits[2 * WORKLOAD_BATCH];
+     uint64_t seed = gen->rng.seed, base = gen->rng.counter;
+     for (int i = 0; i < 2 * WORKLOAD_BATCH; i++) {
+         bits[i] = rngAt(seed, base + i);
+     }
+     gen->rng.counter += 2 * WORKLOAD_BATCH;
+
+     if (gen->dist == DIST_UNIFORM) {
+         // Seconds in 1..-t, then nanoseconds.
+         for (int i = 0; i < WORKLOAD_BATCH; i++) {
+             gen->sec[i] = (int) rngScale(bits[2 * i], gen->limitSec) + 1;
+             gen->nano[i] = (int) rngScale(bits[2 * i + 1], ONE_BILLION);
+         }
+     } else {
+         const double *p = gen->params;
+         for (int i = 0; i < WORKLOAD_BATCH; i++) {
+             double u = workloadUnit(bits[2 * i]), v = workloadUnit(bits[2 * i + 1]);
+             double seconds;
+             switch (gen->dist) {
+                 case DIST_FIXED:
+                     seconds = p[0];
+                     break;
+                 case DIST_EXP:
+                     seconds = workloadExp(p[0], u);
+                     break;
+                 case DIST_PARETO:
+                     seconds = p[1] * pow(1.0 - u, -1.0 / p[0]);
+                     break;
+                 case DIST_BIMODAL:
+                 default:
+                     seconds = workloadExp(u < p[0] ? p[1] : p[2], v);
+                     break;
+             }
+             if (seconds > WORKLOAD_MAX_SECONDS) {
+                 seconds = WORKLOAD_MAX_SECONDS;
+             }
+             unsigned long long ns = (unsigned long long) (seconds * ONE_BILLION);
+             gen->sec[i] = (int) (ns / ONE_BILLION);
+             gen->nano[i] = (int) (ns % ONE_BILLION);
+         }
+     }
+     gen->next = 0;
+ }
+
+ // Function to start a runtime generator (after durationParse, or uniform by default).
+ static inline void durationInit(DurationGen *gen, uint64_t seed, int limitSec) {
+     gen->limitSec = limitSec;
+     rngInit(&gen->rng, seed);
+     durationFill(gen);
+ }
+
+ // Function to take the runtime of the next job.
+ static inline void durationNext(DurationGen *gen, int *sec, int *nano) {
+     if (gen->next == WORKLOAD_BATCH) {
+         durationFill(gen);
+     }
+     *sec = gen->sec[gen->next];
+     *nano = gen->nano[gen->next];
+     gen->next++;
+ }
+
+ // Function to generate the next batch of exponential arrival gaps.
+ static inline void arrivalFill(ArrivalGen *gen) {
+     uint64_t bits[WORKLOAD_BATCH];
+     uint64_t seed = gen->rng.seed, base = gen->rng.counter;
+     for (int i = 0; i < WORKLOAD_BATCH; i++) {
+         bits[i] = rngAt(seed, base + i);
+     }
+     gen->rng.counter += WORKLOAD_BATCH;
+     for (int i = 0; i < WORKLOAD_BATCH; i++) {
+         gen->gap[i] = (unsigned long long) workloadExp(gen->meanNs, workloadUnit(bits[i]));
+     }
+     gen->next = 0;
+ }
+
+ // Function to start an arrival gap generator with the given mean gap.
+ static inline void arrivalInit(ArrivalGen *gen, uint64_t seed, double meanNs) {
+     gen->meanNs = meanNs;
+     rngInit(&gen->rng, seed ^ ARRIVAL_STREAM_KEY);
+     arrivalFill(gen);
+ }
+
+ // Function to take the gap before the next arrival (nanoseconds).
+ static inline unsigned long long arrivalNext(ArrivalGen *gen) {
+     if (gen->next == WORKLOAD_BATCH) {
+         arrivalFill(gen);
+     }
+     return gen->gap[gen->next++];
+ }
+
+ #endif